@@ -0,0 +1,359 @@
+/* Host emulation of the ILI9341 controller behind the SPI stand-in.
+ * Decodes the command stream into a virtual 240*320 panel.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef HOST_PANEL_H
+#define HOST_PANEL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PANEL_WIDTH 240
+#define PANEL_HEIGHT 320
+
+/** Bus traffic as the panel saw it. */
+struct PanelStats
+{
+    uint32_t bytes;
+    uint32_t transactions;      // chip select assertions
+    uint32_t csToggles;
+    uint32_t dcToggles;
+    uint32_t formatSwitches;    // SPI word size changes
+    uint32_t commands;
+    uint32_t pixels;
+};
+
+/** Virtual ILI9341: column/page address set (0x2A/0x2B), memory write and
+ * write continue (0x2C/0x3C) and memory access control (0x36) are decoded
+ * into 240x320 RGB565 display memory, vertical scrolling (0x33/0x37, ended
+ * by 0x13) into the rows the images show. Everything else is only counted.
+ * Bytes sent while chip select is high are ignored like on the wire.
+ *
+ * endFrame() closes a frame's statistics. With the environment variables
+ * PANEL_PPM (a printf pattern such as "frame%04d.ppm") and PANEL_FRAMES set,
+ * frames are written as PPM images, and the program exits with a traffic
+ * summary after that many frames. capture() writes a frame's image early,
+ * for drawing that erases its frame again before the frame ends.
+ */
+class HostPanel
+{
+    private:
+        uint16_t _memory[PANEL_WIDTH * PANEL_HEIGHT];
+
+        int _cs;
+        int _dc;
+        int _bits;
+
+        unsigned char _cmd;
+        int _param;
+        unsigned int _colStart, _colEnd, _pageStart, _pageEnd;
+        unsigned int _col, _page;
+        unsigned char _madctl;
+        int _high;          // first byte of a pixel, -1 when none
+        unsigned char _args[4];     // parameters of the current command
+
+        // vertical scrolling: fixed top rows, scroll area rows, start row
+        unsigned int _scrollTop, _scrollArea, _scrollStart;
+
+        PanelStats _frame;
+        PanelStats _total;
+        int _frames;
+        const char* _ppm;
+        int _maxFrames;
+        bool _captured;     // this frame's image is written
+
+    public:
+        HostPanel()
+        {
+            memset(_memory, 0, sizeof(_memory));
+            _cs = 1;
+            _dc = 1;
+            _bits = 8;
+            _cmd = 0;
+            _param = 0;
+            _colStart = _pageStart = 0;
+            _colEnd = PANEL_WIDTH - 1;
+            _pageEnd = PANEL_HEIGHT - 1;
+            _col = _page = 0;
+            _madctl = 0;
+            _high = -1;
+            resetScroll();
+            memset(&_frame, 0, sizeof(_frame));
+            memset(&_total, 0, sizeof(_total));
+            _frames = 0;
+            _ppm = getenv("PANEL_PPM");
+            _maxFrames = getenv("PANEL_FRAMES") ? atoi(getenv("PANEL_FRAMES")) : 0;
+            _captured = false;
+        }
+
+        static HostPanel& instance()
+        {
+            static HostPanel panel;
+            return panel;
+        }
+
+    // bus side, called by the SPI and DigitalOut stand-ins
+    public:
+        void chipSelect(int level)
+        {
+            if (level == _cs) return;
+            _cs = level;
+            _frame.csToggles++;
+            if (level == 0) _frame.transactions++;
+        }
+
+        void dataCommand(int level)
+        {
+            if (level == _dc) return;
+            _dc = level;
+            _frame.dcToggles++;
+        }
+
+        void format(int bits)
+        {
+            if (bits == _bits) return;
+            _bits = bits;
+            _frame.formatSwitches++;
+        }
+
+        /** One word of the current format, MSB first. */
+        void word(int value)
+        {
+            if (_bits == 16) byte(value >> 8);
+            byte(value);
+        }
+
+        void byte(int value)
+        {
+            if (_cs) return;
+
+            value &= 0xFF;
+            _frame.bytes++;
+            if (_dc == 0) command(value);
+            else data(value);
+        }
+
+    // program side
+    public:
+        int getWidth()
+        {
+            return (_madctl & 0x20) ? PANEL_HEIGHT : PANEL_WIDTH;
+        }
+
+        int getHeight()
+        {
+            return (_madctl & 0x20) ? PANEL_WIDTH : PANEL_HEIGHT;
+        }
+
+        /** Pixel as the program addresses it in the current orientation. */
+        uint16_t pixel(int x, int y)
+        {
+            return _memory[address(x, y)];
+        }
+
+        /** Pixel the panel shows at x, y: pixel() moved by the vertical
+         * scrolling, which shifts panel rows inside the scroll area.
+         */
+        uint16_t shown(int x, int y)
+        {
+            int i = address(x, y);
+            unsigned int row = i / PANEL_WIDTH;
+            if (row >= _scrollTop && row < _scrollTop + _scrollArea) {
+                row = _scrollTop + (row + _scrollStart + _scrollArea - 2 * _scrollTop) % _scrollArea;
+            }
+            return _memory[row * PANEL_WIDTH + i % PANEL_WIDTH];
+        }
+
+        /** True when frames are written or counted for an exit summary. */
+        bool isRecording()
+        {
+            return _ppm != NULL || _maxFrames > 0;
+        }
+
+        PanelStats getFrameStats()
+        {
+            return _frame;
+        }
+
+        /** Write the image of the current frame now, endFrame() then only
+         * closes its statistics.
+         */
+        void capture()
+        {
+            char name[256];
+
+            if (_ppm && !_captured) {
+                snprintf(name, sizeof(name), _ppm, _frames);
+                writePpm(name);
+            }
+            _captured = true;
+        }
+
+        void endFrame()
+        {
+            capture();
+            _captured = false;
+
+            _total.bytes += _frame.bytes;
+            _total.transactions += _frame.transactions;
+            _total.csToggles += _frame.csToggles;
+            _total.dcToggles += _frame.dcToggles;
+            _total.formatSwitches += _frame.formatSwitches;
+            _total.commands += _frame.commands;
+            _total.pixels += _frame.pixels;
+            memset(&_frame, 0, sizeof(_frame));
+
+            if (++_frames == _maxFrames) {
+                printf("panel: %d frames, per frame %lu bytes, %lu transactions, %lu cs and %lu dc toggles, "
+                       "%lu format switches, %lu commands, %lu pixels\n", _frames,
+                       (unsigned long)_total.bytes / _frames, (unsigned long)_total.transactions / _frames,
+                       (unsigned long)_total.csToggles / _frames, (unsigned long)_total.dcToggles / _frames,
+                       (unsigned long)_total.formatSwitches / _frames, (unsigned long)_total.commands / _frames,
+                       (unsigned long)_total.pixels / _frames);
+                // other rendering threads may still run, so the static
+                // destructors are skipped
+                fflush(stdout);
+                _Exit(0);
+            }
+        }
+
+        bool writePpm(const char* name)
+        {
+            FILE* out = fopen(name, "wb");
+            if (!out) return false;
+
+            int w = getWidth(), h = getHeight();
+            fprintf(out, "P6\n%d %d\n255\n", w, h);
+            for (int y = 0; y < h; y++) {
+                for (int x = 0; x < w; x++) {
+                    uint16_t c = shown(x, y);
+                    fputc(((c >> 11) & 0x1F) * 255 / 31, out);
+                    fputc(((c >> 5) & 0x3F) * 255 / 63, out);
+                    fputc((c & 0x1F) * 255 / 31, out);
+                }
+            }
+            fclose(out);
+            return true;
+        }
+
+    private:
+        void command(int cmd)
+        {
+            _cmd = cmd;
+            _param = 0;
+            _frame.commands++;
+
+            if (cmd == 0x2C) {
+                _col = _colStart;
+                _page = _pageStart;
+            }
+            if (cmd == 0x2C || cmd == 0x3C) _high = -1;
+            if (cmd == 0x01 || cmd == 0x13) resetScroll();
+            if (cmd == 0x01) {
+                _madctl = 0;
+                _colStart = _pageStart = 0;
+                _colEnd = PANEL_WIDTH - 1;
+                _pageEnd = PANEL_HEIGHT - 1;
+            }
+        }
+
+        void data(int value)
+        {
+            int n = _param++;
+
+            if (n < 4) _args[n] = value;
+
+            // a start and end pair only takes effect once all four
+            // parameters have arrived, a cut list changes nothing
+            switch (_cmd) {
+                case 0x2A:
+                    if (n == 3) {
+                        _colStart = (_args[0] << 8) | _args[1];
+                        _colEnd = (_args[2] << 8) | _args[3];
+                    }
+                    break;
+
+                case 0x2B:
+                    if (n == 3) {
+                        _pageStart = (_args[0] << 8) | _args[1];
+                        _pageEnd = (_args[2] << 8) | _args[3];
+                    }
+                    break;
+
+                case 0x36:
+                    if (n == 0) _madctl = value;
+                    break;
+
+                case 0x33:
+                    if (n == 3) {
+                        _scrollTop = (_args[0] << 8) | _args[1];
+                        _scrollArea = (_args[2] << 8) | _args[3];
+                    }
+                    break;
+
+                case 0x37:
+                    if (n == 0) _scrollStart = value << 8;
+                    if (n == 1) _scrollStart |= value;
+                    break;
+
+                case 0x2C:
+                case 0x3C:
+                    if (_high < 0) {
+                        _high = value;
+                        break;
+                    }
+                    writePixel((_high << 8) | value);
+                    _high = -1;
+                    break;
+            }
+        }
+
+        void writePixel(uint16_t color)
+        {
+            _frame.pixels++;
+            if (_col < (unsigned int)getWidth() && _page < (unsigned int)getHeight()) {
+                _memory[address(_col, _page)] = color;
+            }
+
+            // the write pointer wraps at the column end, then at the page end
+            if (_col == _colEnd) {
+                _col = _colStart;
+                _page = (_page == _pageEnd) ? _pageStart : _page + 1;
+            } else {
+                _col++;
+            }
+        }
+
+        void resetScroll()
+        {
+            _scrollTop = 0;
+            _scrollArea = PANEL_HEIGHT;
+            _scrollStart = 0;
+        }
+
+        // display memory index of a logical pixel under the current MADCTL
+        int address(int x, int y)
+        {
+            if (_madctl & 0x20) {           // MV: rows and columns exchanged
+                int t = x;
+                x = y;
+                y = t;
+            }
+            if (_madctl & 0x40) x = PANEL_WIDTH - 1 - x;    // MX
+            if (_madctl & 0x80) y = PANEL_HEIGHT - 1 - y;   // MY
+            return y * PANEL_WIDTH + x;
+        }
+};
+
+#endif
@@ -0,0 +1,232 @@
+/* Host stand-in for the parts of mbed os 6 used by this project.
+ * Lets the renderer build and run on Linux (pio run -e native).
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "HostPanel.h"
+
+#define HOST_PANEL 1
+#define DEVICE_SPI_ASYNCH 1
+#define SPI_EVENT_COMPLETE (1 << 3)
+
+enum PinName {
+    SPI_MOSI, SPI_MISO, SPI_SCK, SPI_CS,
+    PE_2, PE_3, PE_4,
+    NC = -1
+};
+
+// pins of the board wiring that drive the emulated controller
+#define PANEL_CS_PIN SPI_CS
+#define PANEL_DC_PIN PE_4
+
+typedef std::function<void(int)> event_callback_t;
+
+template <class T>
+event_callback_t callback(T* obj, void (T::*method)(int))
+{
+    return [obj, method](int event) { (obj->*method)(event); };
+}
+
+inline uint32_t us_ticker_read()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline void wait_us(int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+inline void thread_sleep_for(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+
+enum osPriority_t { osPriorityNormal = 24 };
+typedef int osStatus;
+#define osOK 0
+
+/** RTOS thread on a std::thread. Priorities and stack sizes are accepted
+ * and ignored, the host schedules the threads.
+ */
+class Thread
+{
+    private:
+        std::thread _thread;
+
+    public:
+        Thread(osPriority_t priority = osPriorityNormal, uint32_t stack_size = 0) {}
+
+        ~Thread()
+        {
+            if (_thread.joinable()) _thread.detach();
+        }
+
+        osStatus start(std::function<void()> task)
+        {
+            _thread = std::thread(task);
+            return osOK;
+        }
+
+        osStatus join()
+        {
+            _thread.join();
+            return osOK;
+        }
+};
+
+namespace ThisThread
+{
+    inline void yield()
+    {
+        std::this_thread::yield();
+    }
+}
+
+
+class DigitalOut
+{
+    private:
+        PinName _pin;
+        int _value;
+
+    public:
+        DigitalOut(PinName pin, int value = 0) : _pin(pin), _value(value) {}
+
+        void write(int value)
+        {
+            _value = value;
+            if (_pin == PANEL_CS_PIN) HostPanel::instance().chipSelect(value);
+            if (_pin == PANEL_DC_PIN) HostPanel::instance().dataCommand(value);
+        }
+        int read() { return _value; }
+};
+
+
+/** SPI master wired to the emulated controller (see HostPanel). Asynchronous
+ * transfers are decoded and complete on a worker thread after the time they
+ * would take on the wire, so the overlap of drawing and sending can be
+ * measured on the host.
+ */
+class SPI
+{
+    private:
+        struct Job {
+            const char* data;
+            int bytes;
+            event_callback_t callback;
+            int event;
+        };
+
+        int _bits;
+        int _hz;
+
+        std::thread _worker;
+        std::mutex _lock;
+        std::condition_variable _wake;
+        std::deque<Job> _jobs;
+        bool _quit;
+
+    public:
+        SPI(PinName mosi, PinName miso, PinName sclk) : _bits(8), _hz(1000000), _quit(false)
+        {
+            _worker = std::thread(&SPI::run, this);
+        }
+
+        ~SPI()
+        {
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                _quit = true;
+            }
+            _wake.notify_one();
+            _worker.join();
+        }
+
+        void format(int bits, int mode = 0)
+        {
+            _bits = bits;
+            HostPanel::instance().format(bits);
+        }
+
+        void frequency(int hz) { _hz = hz; }
+
+        int write(int value)
+        {
+            HostPanel::instance().word(value);
+            return 0;
+        }
+
+        int write(const char* tx_buffer, int tx_length, char* rx_buffer, int rx_length)
+        {
+            for (int i = 0; i < tx_length; i++) {
+                HostPanel::instance().byte(tx_buffer[i]);
+            }
+            return tx_length;
+        }
+
+        template <typename Type>
+        int transfer(const Type* tx_buffer, int tx_length, Type* rx_buffer, int rx_length,
+                     const event_callback_t& callback, int event = SPI_EVENT_COMPLETE)
+        {
+            Job job = { (const char*)tx_buffer, tx_length, callback, event };
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                _jobs.push_back(job);
+            }
+            _wake.notify_one();
+            return 0;
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            while (true) {
+                _wake.wait(guard, [this] { return _quit || !_jobs.empty(); });
+                if (_quit) return;
+
+                Job job = _jobs.front();
+                _jobs.pop_front();
+                guard.unlock();
+
+                for (int i = 0; i < job.bytes; i++) {
+                    HostPanel::instance().byte(job.data[i]);
+                }
+
+                // time on the wire, then the "interrupt"
+                std::this_thread::sleep_for(std::chrono::nanoseconds(8000000000LL * job.bytes / _hz));
+                if (job.callback) job.callback(job.event);
+
+                guard.lock();
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,238 @@
+/* Band (sort-middle) renderer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "BandRenderer.h"
+
+#define BAND_LINE 0
+#define BAND_TRIANGLE 1
+#define BAND_LINE_AA 2
+
+// rasterizer spans straight into the band buffer
+struct BandSpan
+{
+    FrameBuffer* fb;
+    int color;
+    int clipX0, clipX1;
+
+    void operator()(int x0, int x1, int y)
+    {
+        if (x0 < clipX0) x0 = clipX0;
+        if (x1 > clipX1) x1 = clipX1;
+        if (x0 <= x1) fb->fill(x0, y, x1 - x0 + 1, 1, color);
+    }
+};
+
+
+BandRenderer::BandRenderer(ILI9341_Mbed* lcd, int background) : _band(BAND_WIDTH, BAND_HEIGHT)
+{
+    _lcd = lcd;
+    _background = background;
+    _peakRam = 0;
+
+    // fill the buffer once, afterwards clear() keeps it at the background
+    _band.fill(0, 0, BAND_WIDTH, BAND_HEIGHT, background);
+    _band.clear(background);
+
+    for (int b = 0; b < BAND_COUNT; b++) {
+        _sentX0[b] = 0;
+        _sentX1[b] = -1;
+        _sentY0[b] = 0;
+        _sentY1[b] = -1;
+    }
+}
+
+/** Start recording a frame. */
+void BandRenderer::begin()
+{
+    _commands.clear();
+}
+
+/** Record a line, end points in pixels. */
+void BandRenderer::line(int x0, int y0, int x1, int y1, int color)
+{
+    BandCommand c;
+    c.type = BAND_LINE;
+    c.color = color;
+    c.x[0] = x0;
+    c.y[0] = y0;
+    c.x[1] = x1;
+    c.y[1] = y1;
+    _commands.push_back(c);
+}
+
+/** Record an anti-aliased line, blended within its band (see lineAA()). */
+void BandRenderer::lineAA(int x0, int y0, int x1, int y1, int color)
+{
+    line(x0, y0, x1, y1, color);
+    _commands.back().type = BAND_LINE_AA;
+}
+
+/** Record a filled triangle, corners in sub-pixel units (see rasterFixed()). */
+void BandRenderer::fillTriangleSub(int x0, int y0, int x1, int y1, int x2, int y2, int color)
+{
+    BandCommand c;
+    c.type = BAND_TRIANGLE;
+    c.color = color;
+    c.x[0] = x0;
+    c.y[0] = y0;
+    c.x[1] = x1;
+    c.y[1] = y1;
+    c.x[2] = x2;
+    c.y[2] = y2;
+    _commands.push_back(c);
+}
+
+// bands a command touches, false when it is off the screen
+static bool bandRange(const BandCommand& c, int bands, int& first, int& last)
+{
+    int top = c.y[0], bottom = c.y[0];
+    int corners = (c.type == BAND_TRIANGLE) ? 3 : 2;
+    for (int i = 1; i < corners; i++) {
+        if (c.y[i] < top) top = c.y[i];
+        if (c.y[i] > bottom) bottom = c.y[i];
+    }
+
+    // triangle corners are in sub-pixels
+    if (c.type == BAND_TRIANGLE) {
+        top = (int)RasterEdge::floorDiv(top, RASTER_ONE);
+        bottom = (int)RasterEdge::floorDiv(bottom, RASTER_ONE);
+    }
+
+    first = (int)RasterEdge::floorDiv(top, BAND_HEIGHT);
+    last = (int)RasterEdge::floorDiv(bottom, BAND_HEIGHT);
+    if (first < 0) first = 0;
+    if (last >= bands) last = bands - 1;
+    return first <= last;
+}
+
+/** Bin the recorded primitives, render and send the frame band by band. */
+void BandRenderer::end()
+{
+    int width = _lcd->getWidth();
+    int height = _lcd->getHeight();
+    FrameBuffer* fb = _lcd->getFrameBuffer();
+    int clipX0, clipY0, clipX1, clipY1;
+    _lcd->getClip(clipX0, clipY0, clipX1, clipY1);
+    int bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    int first, last;
+
+    // count per band, then place the indices: commands keep their order
+    memset(_binStart, 0, sizeof(_binStart));
+    for (size_t i = 0; i < _commands.size(); i++) {
+        if (!bandRange(_commands[i], bands, first, last)) continue;
+        for (int b = first; b <= last; b++) _binStart[b + 1]++;
+    }
+    for (int b = 0; b < BAND_COUNT; b++) _binStart[b + 1] += _binStart[b];
+
+    _bins.resize(_binStart[BAND_COUNT]);
+    for (size_t i = 0; i < _commands.size(); i++) {
+        if (!bandRange(_commands[i], bands, first, last)) continue;
+        for (int b = first; b <= last; b++) _bins[_binStart[b]++] = i;
+    }
+
+    // the placing moved every start to the next band's
+    for (int b = BAND_COUNT; b > 0; b--) _binStart[b] = _binStart[b - 1];
+    _binStart[0] = 0;
+
+    // every band is cut to the caller's clip rectangle
+    if (clipX0 < 0) clipX0 = 0;
+    if (clipX1 >= width) clipX1 = width - 1;
+    _lcd->beginBatch();
+    for (int b = 0; b < bands; b++) {
+        int top = b * BAND_HEIGHT;
+        int bottom = (top + BAND_HEIGHT > height) ? height - 1 : top + BAND_HEIGHT - 1;
+        if (clipY0 > top) top = clipY0;
+        if (clipY1 < bottom) bottom = clipY1;
+        if (clipX0 <= clipX1 && top <= bottom) renderBand(b, clipX0, top, clipX1, bottom);
+    }
+    _lcd->endBatch();
+
+    _lcd->setClip(clipX0, clipY0, clipX1, clipY1);
+    _lcd->setFrameBuffer(fb);
+
+    int ram = sizeof(*this) + BAND_WIDTH * BAND_HEIGHT * sizeof(uint16_t) +
+              _commands.capacity() * sizeof(BandCommand) + _bins.capacity() * sizeof(uint32_t);
+    if (ram > _peakRam) _peakRam = ram;
+}
+
+// One band, drawn and sent inside clipX0, clipY0, clipX1, clipY1: the
+// band's rows cut to the caller's clip rectangle
+void BandRenderer::renderBand(int band, int clipX0, int clipY0, int clipX1, int clipY1)
+{
+    bool empty = (_binStart[band] == _binStart[band + 1]);
+    if (empty && _sentX0[band] > _sentX1[band]) return;
+
+    int top = band * BAND_HEIGHT;
+
+    // wipe what the previous band left, then draw this one's primitives
+    _band.setOrigin(0, top);
+    _band.clear(_background);
+    _band.clearDirty();
+
+    // lines are cut to the band before they are rasterized
+    _lcd->setFrameBuffer(&_band);
+    _lcd->setClip(clipX0, clipY0, clipX1, clipY1);
+    BandSpan span = { &_band, 0, clipX0, clipX1 };
+    for (uint32_t i = _binStart[band]; i < _binStart[band + 1]; i++) {
+        BandCommand& c = _commands[_bins[i]];
+        if (c.type == BAND_LINE) {
+            _lcd->line(c.x[0], c.y[0], c.x[1], c.y[1], c.color);
+        } else if (c.type == BAND_LINE_AA) {
+            _lcd->lineAA(c.x[0], c.y[0], c.x[1], c.y[1], c.color);
+        } else {
+            span.color = c.color;
+            rasterTriangle(c.x[0], c.y[0], c.x[1], c.y[1], c.x[2], c.y[2], span, clipY0, clipY1 + 1);
+        }
+    }
+
+    // send this frame's image over what the previous frame left there,
+    // inside the clip rectangle
+    int x, y, w, h;
+    int x0 = _sentX0[band], y0 = _sentY0[band], x1 = _sentX1[band], y1 = _sentY1[band];
+    if (_band.getUsed(x, y, w, h)) {
+        _sentX0[band] = x;
+        _sentY0[band] = y;
+        _sentX1[band] = x + w - 1;
+        _sentY1[band] = y + h - 1;
+    } else {
+        _sentX0[band] = 0;
+        _sentX1[band] = -1;
+        _sentY0[band] = 0;
+        _sentY1[band] = -1;
+    }
+    if (x0 > x1) {
+        x0 = _sentX0[band];
+        y0 = _sentY0[band];
+        x1 = _sentX1[band];
+        y1 = _sentY1[band];
+    } else if (_sentX0[band] <= _sentX1[band]) {
+        if (_sentX0[band] < x0) x0 = _sentX0[band];
+        if (_sentY0[band] < y0) y0 = _sentY0[band];
+        if (_sentX1[band] > x1) x1 = _sentX1[band];
+        if (_sentY1[band] > y1) y1 = _sentY1[band];
+    }
+    if (x0 < clipX0) x0 = clipX0;
+    if (y0 < clipY0 - top) y0 = clipY0 - top;
+    if (x1 > clipX1) x1 = clipX1;
+    if (y1 > clipY1 - top) y1 = clipY1 - top;
+
+    if (x0 <= x1 && y0 <= y1) {
+        _band.markDirty(x0, y0, x1, y1);
+        _lcd->flush();
+    }
+}
+
+int BandRenderer::getPeakRam()
+{
+    return _peakRam;
+}
@@ -0,0 +1,87 @@
+/* Band (sort-middle) renderer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef BANDRENDERER_H
+#define BANDRENDERER_H
+
+#include "mbed.h"
+#include "ILI9341_Mbed.h"
+#include <vector>
+
+#ifndef BAND_HEIGHT
+#define BAND_HEIGHT 16          // rows per band, more RAM but fewer windows
+#endif
+
+#define BAND_WIDTH (TFT_WIDTH > TFT_HEIGHT ? TFT_WIDTH : TFT_HEIGHT)
+#define BAND_COUNT ((BAND_WIDTH + BAND_HEIGHT - 1) / BAND_HEIGHT)
+
+/** Primitive recorded for the bands. 32 bit coordinates: triangle corners
+ * are sub-pixels, and near-clipped corners project far off the screen.
+ */
+struct BandCommand
+{
+    int32_t x[3];
+    int32_t y[3];
+    uint16_t color;
+    uint8_t type;
+};
+
+/** Frame renderer for targets without RAM for a whole frame buffer.
+ *
+ * Between begin() and end() primitives are only recorded. end() sorts them
+ * into horizontal bands of BAND_HEIGHT rows, then renders each band into one
+ * BAND_WIDTH x BAND_HEIGHT buffer (10 KB for 320x16) and sends it with a
+ * single window and memory write. A band is sent over the columns drawn in
+ * this frame or the previous one, untouched bands are skipped, so no erase
+ * pass is needed. Primitives keep their recording order within a band.
+ *
+ * Drawing stays inside the driver's clip rectangle, bands outside it are
+ * skipped. end() leaves the driver's frame buffer and clip rectangle as
+ * they were.
+ * getPeakRam() reports the band buffer plus the largest command and bin
+ * storage used so far.
+ */
+class BandRenderer
+{
+    private:
+        ILI9341_Mbed* _lcd;
+        FrameBuffer _band;
+        int _background;
+
+        std::vector<BandCommand> _commands;
+        std::vector<uint32_t> _bins;        // command indices, band by band
+        uint32_t _binStart[BAND_COUNT + 1];
+
+        // inclusive bounds sent per band last frame, empty when x0 > x1
+        int16_t _sentX0[BAND_COUNT], _sentY0[BAND_COUNT];
+        int16_t _sentX1[BAND_COUNT], _sentY1[BAND_COUNT];
+
+        int _peakRam;
+
+    public:
+        BandRenderer(ILI9341_Mbed* lcd, int background = Black);
+
+        void begin();
+        void end();
+
+        void line(int x0, int y0, int x1, int y1, int color);
+        void lineAA(int x0, int y0, int x1, int y1, int color);
+        void fillTriangleSub(int x0, int y0, int x1, int y1, int x2, int y2, int color);
+
+        int getPeakRam();
+
+    private:
+        void renderBand(int band, int clipX0, int clipY0, int clipX1, int clipY1);
+};
+
+#endif
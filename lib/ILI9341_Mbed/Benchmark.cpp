@@ -0,0 +1,316 @@
+/* Micro benchmarks of the ILI9341_Mbed pixel paths.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Benchmark.h"
+#include "ILI9341_Mbed.h"
+
+#ifdef RENDER_BENCH
+
+#define BENCH_WIDTH 320
+#define BENCH_HEIGHT 64
+#define BENCH_PIXELS 4096       // kernel working set
+#define BENCH_LINES 256
+
+static uint16_t benchSrc[BENCH_PIXELS];
+static uint16_t benchDst[BENCH_PIXELS];
+static volatile uint32_t benchSink;     // keeps results alive
+
+// xorshift, the same sequence on every target
+static uint32_t benchSeed = 2463534242u;
+static uint32_t benchRandom()
+{
+    benchSeed ^= benchSeed << 13;
+    benchSeed ^= benchSeed >> 17;
+    benchSeed ^= benchSeed << 5;
+    return benchSeed;
+}
+
+// hundredths of a nanosecond per item, kernels take less than one per
+// pixel on the host
+static unsigned long benchNs100(uint32_t us, uint32_t items)
+{
+    return (unsigned long)((uint64_t)us * 100000 / items);
+}
+
+static void benchReport(const char* name, uint32_t us, uint32_t items, const char* unit)
+{
+    unsigned long ns100 = benchNs100(us, items);
+    printf("%-16s %7lu.%02lu ns/%s\n", name, ns100 / 100, ns100 % 100, unit);
+}
+
+static uint16_t benchRef[BENCH_PIXELS];
+
+// repeats of a kernel over the working set, enough for a few ms on the host
+#define BENCH_REPEAT 256
+#define BENCH_KEY 0xF81F        // magenta, the usual sprite colour key
+#define BENCH_STRIDE 64         // copyRect565: 60 pixel wide rows of 64
+
+// every kernel behind the same signature
+typedef void (*BenchKernel)(uint16_t* dst, const uint16_t* src, int count);
+
+static void fillFast(uint16_t* dst, const uint16_t* src, int count) { fill565(dst + 1, src[0], count - 1); }
+static void fillRef(uint16_t* dst, const uint16_t* src, int count) { fill565Ref(dst + 1, src[0], count - 1); }
+static void copyFast(uint16_t* dst, const uint16_t* src, int count) { copy565(dst, src, count); }
+static void copyRef(uint16_t* dst, const uint16_t* src, int count) { copy565Ref(dst, src, count); }
+static void rectFast(uint16_t* dst, const uint16_t* src, int count)
+{
+    copyRect565(dst + 1, BENCH_STRIDE, src + 3, BENCH_STRIDE, BENCH_STRIDE - 4, count / BENCH_STRIDE - 1);
+}
+static void rectRef(uint16_t* dst, const uint16_t* src, int count)
+{
+    copyRect565Ref(dst + 1, BENCH_STRIDE, src + 3, BENCH_STRIDE, BENCH_STRIDE - 4, count / BENCH_STRIDE - 1);
+}
+static void halfFast(uint16_t* dst, const uint16_t* src, int count) { blendHalf565(dst, src, count); }
+static void halfRef(uint16_t* dst, const uint16_t* src, int count) { blendHalf565Ref(dst, src, count); }
+static void alphaFast(uint16_t* dst, const uint16_t* src, int count) { blendAlpha565(dst, src, 11, count); }
+static void alphaRef(uint16_t* dst, const uint16_t* src, int count) { blendAlpha565Ref(dst, src, 11, count); }
+static void keyFast(uint16_t* dst, const uint16_t* src, int count) { copyKey565(dst, src, BENCH_KEY, count); }
+static void keyRef(uint16_t* dst, const uint16_t* src, int count) { copyKey565Ref(dst, src, BENCH_KEY, count); }
+static void swapFast(uint16_t* dst, const uint16_t* src, int count) { swap565(dst, src + 1, count - 1); }
+static void swapRef(uint16_t* dst, const uint16_t* src, int count) { swap565Ref(dst, src + 1, count - 1); }
+
+static const struct
+{
+    const char* name;
+    BenchKernel fast;
+    BenchKernel ref;
+} benchKernels[] = {
+    { "fill565", fillFast, fillRef },
+    { "copy565", copyFast, copyRef },
+    { "copyRect565", rectFast, rectRef },
+    { "blendHalf565", halfFast, halfRef },
+    { "blendAlpha565", alphaFast, alphaRef },
+    { "copyKey565", keyFast, keyRef },
+    { "swap565", swapFast, swapRef },
+};
+
+static uint32_t benchTime(BenchKernel kernel)
+{
+    uint32_t start = us_ticker_read();
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+        kernel(benchDst, benchSrc, BENCH_PIXELS);
+    }
+    benchSink = benchDst[0];
+    return us_ticker_read() - start;
+}
+
+// same output as the reference, odd starts and lengths included
+static bool benchCheck(BenchKernel fast, BenchKernel ref)
+{
+    for (int i = 0; i < BENCH_PIXELS; i++) {
+        benchDst[i] = benchRef[i] = benchRandom();
+    }
+    fast(benchDst, benchSrc, BENCH_PIXELS);
+    ref(benchRef, benchSrc, BENCH_PIXELS);
+    fast(benchDst + 1, benchSrc + 2, BENCH_PIXELS - 3);
+    ref(benchRef + 1, benchSrc + 2, BENCH_PIXELS - 3);
+    return memcmp(benchDst, benchRef, sizeof(benchDst)) == 0;
+}
+
+static void benchKernelSet()
+{
+    // sprite-like source: runs of the colour key between random pixels
+    for (int i = 0; i < BENCH_PIXELS; i++) {
+        benchSrc[i] = ((i / 7) % 3 == 0) ? BENCH_KEY : benchRandom();
+    }
+
+    for (size_t k = 0; k < sizeof(benchKernels) / sizeof(benchKernels[0]); k++) {
+        if (!benchCheck(benchKernels[k].fast, benchKernels[k].ref)) {
+            printf("%-20s differs from the reference\n", benchKernels[k].name);
+            continue;
+        }
+
+        uint32_t fast = benchTime(benchKernels[k].fast);
+        uint32_t ref = benchTime(benchKernels[k].ref);
+        unsigned long f = benchNs100(fast, BENCH_REPEAT * BENCH_PIXELS);
+        unsigned long r = benchNs100(ref, BENCH_REPEAT * BENCH_PIXELS);
+        printf("%-16s %7lu.%02lu ns/px, reference %7lu.%02lu ns/px\n", benchKernels[k].name,
+               f / 100, f % 100, r / 100, r % 100);
+    }
+}
+
+// the same random lines drawn plain and anti-aliased
+static void benchLines(ILI9341_Mbed* lcd, bool antialias)
+{
+    uint32_t start = us_ticker_read();
+    for (int r = 0; r < BENCH_REPEAT / 16; r++) {
+        benchSeed = 88172645u;
+        for (int i = 0; i < BENCH_LINES; i++) {
+            uint32_t a = benchRandom(), b = benchRandom();
+            int x0 = a % BENCH_WIDTH, y0 = (a >> 16) % BENCH_HEIGHT;
+            int x1 = b % BENCH_WIDTH, y1 = (b >> 16) % BENCH_HEIGHT;
+            if (antialias) lcd->lineAA(x0, y0, x1, y1, Green);
+            else lcd->line(x0, y0, x1, y1, Green);
+        }
+    }
+    benchReport(antialias ? "lineAA" : "line", us_ticker_read() - start, BENCH_REPEAT / 16 * BENCH_LINES,
+                "line");
+}
+
+#define BENCH_SPRITE_W 48
+#define BENCH_SPRITE_H 40
+#define BENCH_SPRITES 64
+
+static uint16_t benchSprite[BENCH_SPRITE_W * BENCH_SPRITE_H];
+static uint16_t benchRuns[BENCH_SPRITE_W * BENCH_SPRITE_H * 2];
+static uint16_t benchTarget[BENCH_WIDTH * BENCH_HEIGHT];
+
+// the runs img2bitmap.py writes: repeats of three or more and of the key,
+// literals in between
+static int benchEncode(const uint16_t* pixels, int w, int h, uint16_t* out)
+{
+    uint16_t* o = out;
+    for (int y = 0; y < h; y++) {
+        const uint16_t* p = pixels + y * w;
+        uint16_t* literal = NULL;
+        for (int x = 0; x < w; ) {
+            int n = 1;
+            while (x + n < w && p[x + n] == p[x]) n++;
+            if (n >= 3 || p[x] == BENCH_KEY) {
+                *o++ = n;
+                *o++ = p[x];
+                literal = NULL;
+            } else {
+                if (!literal) {
+                    literal = o++;
+                    *literal = BITMAP_LITERAL;
+                }
+                for (int i = 0; i < n; i++) *o++ = p[x + i];
+                *literal += n;
+            }
+            x += n;
+        }
+    }
+    return o - out;
+}
+
+// the same sprites drawn keyed from raw and RLE data, opaque from raw
+static void benchBitmap(ILI9341_Mbed* lcd, FrameBuffer* target, const char* name, const Bitmap565& bitmap)
+{
+    target->clear(Black);
+    uint32_t start = us_ticker_read();
+    for (int r = 0; r < BENCH_REPEAT / 16; r++) {
+        benchSeed = 88172645u;
+        for (int i = 0; i < BENCH_SPRITES; i++) {
+            uint32_t a = benchRandom();
+            lcd->drawBitmap(a % BENCH_WIDTH - BENCH_SPRITE_W / 2, (a >> 16) % BENCH_HEIGHT - BENCH_SPRITE_H / 2,
+                            bitmap);
+        }
+    }
+    benchReport(name, us_ticker_read() - start, BENCH_REPEAT / 16 * BENCH_SPRITES * BENCH_SPRITE_W * BENCH_SPRITE_H,
+                "px");
+}
+
+static void benchBitmaps(ILI9341_Mbed* lcd, FrameBuffer* target)
+{
+    // a disc of horizontal bands on the colour key
+    for (int y = 0; y < BENCH_SPRITE_H; y++) {
+        for (int x = 0; x < BENCH_SPRITE_W; x++) {
+            int dx = 2 * x - BENCH_SPRITE_W + 1, dy = 2 * y - BENCH_SPRITE_H + 1;
+            bool inside = dx * dx + dy * dy < BENCH_SPRITE_H * BENCH_SPRITE_H;
+            benchSprite[y * BENCH_SPRITE_W + x] = inside ? ((y & 4) ? Yellow : (uint16_t)(x * 0x0841)) : BENCH_KEY;
+        }
+    }
+    benchEncode(benchSprite, BENCH_SPRITE_W, BENCH_SPRITE_H, benchRuns);
+
+    Bitmap565 raw = { BENCH_SPRITE_W, BENCH_SPRITE_H, BITMAP_RAW, 1, BENCH_KEY, benchSprite };
+    Bitmap565 rle = { BENCH_SPRITE_W, BENCH_SPRITE_H, BITMAP_RLE, 1, BENCH_KEY, benchRuns };
+    Bitmap565 opaque = { BENCH_SPRITE_W, BENCH_SPRITE_H, BITMAP_RAW, 0, 0, benchSprite };
+
+    benchBitmap(lcd, target, "drawBitmap RLE", rle);
+    memcpy(benchTarget, target->row(0), sizeof(benchTarget));
+    benchBitmap(lcd, target, "drawBitmap keyed", raw);
+    if (memcmp(benchTarget, target->row(0), sizeof(benchTarget)) != 0) {
+        printf("drawBitmap RLE differs from the raw bitmap\n");
+    }
+    benchBitmap(lcd, target, "drawBitmap", opaque);
+}
+
+#define BENCH_PRIMITIVES 1024
+#define BENCH_SPAN 11           // straight line length in pixels
+
+// one primitive drawn straight to the panel at x, y
+typedef void (*BenchPrimitive)(ILI9341_Mbed* lcd, int x, int y);
+
+static void pixelOnPanel(ILI9341_Mbed* lcd, int x, int y) { lcd->putPixel(x, y, Green); }
+static void hlineOnPanel(ILI9341_Mbed* lcd, int x, int y) { lcd->line(x, y, x + BENCH_SPAN - 1, y, Green); }
+static void vlineOnPanel(ILI9341_Mbed* lcd, int x, int y) { lcd->line(x, y, x, y + BENCH_SPAN - 1, Green); }
+static void rectOnPanel(ILI9341_Mbed* lcd, int x, int y)
+{
+    lcd->fillRect(x, y, x + BENCH_SPAN - 1, y + BENCH_SPAN - 1, Green);
+}
+static void lineOnPanel(ILI9341_Mbed* lcd, int x, int y) { lcd->line(x, y, x + 3 * BENCH_SPAN, y + BENCH_SPAN, Green); }
+
+static const struct
+{
+    const char* name;
+    BenchPrimitive draw;
+} benchPrimitives[] = {
+    { "putPixel", pixelOnPanel },
+    { "hline", hlineOnPanel },
+    { "vline", vlineOnPanel },
+    { "fillRect", rectOnPanel },
+    { "line", lineOnPanel },
+};
+
+// bus cost of single primitives at scattered places, each in a transaction
+// of its own; on the host the emulated panel adds the SPI format switches
+static void benchBus(ILI9341_Mbed* lcd)
+{
+    for (size_t k = 0; k < sizeof(benchPrimitives) / sizeof(benchPrimitives[0]); k++) {
+        lcd->resetBusStats();
+#ifdef HOST_PANEL
+        PanelStats before = HostPanel::instance().getFrameStats();
+#endif
+        benchSeed = 88172645u;
+        uint32_t start = us_ticker_read();
+        for (int i = 0; i < BENCH_PRIMITIVES; i++) {
+            uint32_t a = benchRandom();
+            benchPrimitives[k].draw(lcd, a % (BENCH_WIDTH - 4 * BENCH_SPAN), (a >> 16) % (BENCH_HEIGHT - BENCH_SPAN));
+        }
+        uint32_t us = us_ticker_read() - start;
+
+        BusStats bus = lcd->getBusStats();
+        unsigned long bytes = bus.bytes * 100UL / BENCH_PRIMITIVES;
+        unsigned long gpio = bus.gpioWrites * 100UL / BENCH_PRIMITIVES;
+        unsigned long ns100 = benchNs100(us, BENCH_PRIMITIVES);
+        printf("%-16s %4lu.%02lu bytes, %4lu.%02lu gpio writes", benchPrimitives[k].name,
+               bytes / 100, bytes % 100, gpio / 100, gpio % 100);
+#ifdef HOST_PANEL
+        uint32_t switches = HostPanel::instance().getFrameStats().formatSwitches - before.formatSwitches;
+        unsigned long formats = switches * 100UL / BENCH_PRIMITIVES;
+        printf(", %lu.%02lu format switches", formats / 100, formats % 100);
+#endif
+        printf(", %lu.%02lu ns per primitive\n", ns100 / 100, ns100 % 100);
+    }
+    lcd->resetBusStats();
+}
+
+void runBenchmarks(ILI9341_Mbed* lcd)
+{
+    FrameBuffer target(BENCH_WIDTH, BENCH_HEIGHT);
+    FrameBuffer* fb = lcd->getFrameBuffer();
+    lcd->setFrameBuffer(&target);
+
+    printf("benchmarks, %d pixels x %d\n", BENCH_PIXELS, BENCH_REPEAT);
+    benchKernelSet();
+    benchLines(lcd, false);
+    benchLines(lcd, true);
+    benchBitmaps(lcd, &target);
+
+    lcd->setFrameBuffer(NULL);
+    benchBus(lcd);
+    lcd->setFrameBuffer(fb);
+}
+
+#endif
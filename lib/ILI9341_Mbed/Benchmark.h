@@ -0,0 +1,34 @@
+/* Micro benchmarks of the ILI9341_Mbed pixel paths.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "mbed.h"
+
+class ILI9341_Mbed;
+
+/** Times the pixel kernels against their reference versions and the
+ * drawing paths into a RAM target, printing nanoseconds per item.
+ * Results are checked against the references before they are timed.
+ *
+ * The RAM paths draw into a 320x64 FrameBuffer attached to lcd (40 KB, so
+ * it also runs on the target). Then single pixels, straight lines,
+ * rectangles and lines are drawn straight to the panel over the same area
+ * and their bus cost per primitive is printed: bytes and GPIO writes from
+ * the driver's bus statistics, SPI format switches from the emulated panel
+ * on the host. Only compiled in with RENDER_BENCH.
+ */
+void runBenchmarks(ILI9341_Mbed* lcd);
+
+#endif
@@ -0,0 +1,76 @@
+/* 16 bit depth buffer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "DepthBuffer.h"
+
+
+DepthBuffer::DepthBuffer(int width, int height, uint16_t* depth)
+{
+    _width = width;
+    _height = height;
+
+    _ownsDepth = (depth == NULL);
+    if (_ownsDepth) {
+        depth = new uint16_t[width * height];
+    }
+    _depth = depth;
+
+    // everything is far until the first clear()
+    _usedX0 = 0;
+    _usedY0 = 0;
+    _usedX1 = _width - 1;
+    _usedY1 = _height - 1;
+    clear();
+}
+
+DepthBuffer::~DepthBuffer()
+{
+    if (_ownsDepth) {
+        delete[] _depth;
+    }
+}
+
+int DepthBuffer::getWidth()
+{
+    return _width;
+}
+
+int DepthBuffer::getHeight()
+{
+    return _height;
+}
+
+void DepthBuffer::clear()
+{
+    if (_usedX0 > _usedX1) return;
+
+    for (int y = _usedY0; y <= _usedY1; y++) {
+        uint16_t* d = &_depth[y * _width];
+        for (int x = _usedX0; x <= _usedX1; x++) {
+            d[x] = DEPTH_FAR;
+        }
+    }
+
+    _usedX0 = _width;
+    _usedY0 = _height;
+    _usedX1 = -1;
+    _usedY1 = -1;
+}
+
+void DepthBuffer::markUsed(int x0, int y0, int x1, int y1)
+{
+    if (x0 < _usedX0) _usedX0 = x0;
+    if (y0 < _usedY0) _usedY0 = y0;
+    if (x1 > _usedX1) _usedX1 = x1;
+    if (y1 > _usedY1) _usedY1 = y1;
+}
@@ -0,0 +1,87 @@
+/* 16 bit depth buffer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef DEPTHBUFFER_H
+#define DEPTHBUFFER_H
+
+#include "mbed.h"
+
+#define DEPTH_FAR 0xFFFF
+
+/** One 16 bit depth per pixel, smaller is nearer.
+ *
+ * testSpan() depth-tests a rasterizer span and hands on only the runs of
+ * pixels that passed, so hidden pixels never reach the SPI bus. Costs
+ * width * height * 2 bytes, 150 KB for 320x240; clear() only resets the
+ * area touched since the previous clear.
+ */
+class DepthBuffer
+{
+    private:
+        uint16_t* _depth;
+        bool _ownsDepth;
+        int _width;
+        int _height;
+
+        // inclusive bounds of the touched area, empty when x0 > x1
+        int _usedX0, _usedY0, _usedX1, _usedY1;
+
+    public:
+        DepthBuffer(int width, int height, uint16_t* depth = NULL);
+        ~DepthBuffer();
+
+        int getWidth();
+        int getHeight();
+
+        void clear();
+
+        /** Test pixels x0..x1 of row y, depth z at x0 and dz per pixel both
+         * in 16.8 fixed point. Passing pixels are stored and reported to
+         * span(x0, x1, y) in runs.
+         */
+        template <class Span>
+        void testSpan(int x0, int x1, int y, int32_t z, int32_t dz, Span& span)
+        {
+            if (y < 0 || y >= _height) return;
+            if (x0 < 0) {
+                z -= dz * x0;
+                x0 = 0;
+            }
+            if (x1 >= _width) x1 = _width - 1;
+            if (x0 > x1) return;
+
+            markUsed(x0, y, x1, y);
+
+            uint16_t* d = &_depth[y * _width];
+            int run = -1;
+            for (int x = x0; x <= x1; x++, z += dz) {
+                int32_t v = z >> 8;
+                if (v < 0) v = 0;
+                if (v > DEPTH_FAR) v = DEPTH_FAR;
+
+                if (v < d[x]) {
+                    d[x] = v;
+                    if (run < 0) run = x;
+                } else if (run >= 0) {
+                    span(run, x - 1, y);
+                    run = -1;
+                }
+            }
+            if (run >= 0) span(run, x1, y);
+        }
+
+    private:
+        void markUsed(int x0, int y0, int x1, int y1);
+};
+
+#endif
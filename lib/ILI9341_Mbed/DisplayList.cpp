@@ -0,0 +1,495 @@
+/* Recorded drawing commands for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "DisplayList.h"
+
+#define DISPLAY_NONE 0              // dropped by optimize()
+#define DISPLAY_PIXEL 1
+#define DISPLAY_RECT 2
+#define DISPLAY_FILL_RECT 3
+#define DISPLAY_LINE 4
+#define DISPLAY_LINE_AA 5
+#define DISPLAY_TRIANGLE 6          // corners in sub-pixels
+#define DISPLAY_CIRCLE 7
+#define DISPLAY_FILL_CIRCLE 8
+#define DISPLAY_ELLIPSE 9
+#define DISPLAY_FILL_ELLIPSE 10
+#define DISPLAY_ROUND_RECT 11
+#define DISPLAY_FILL_ROUND_RECT 12
+#define DISPLAY_ARC 13
+#define DISPLAY_FILL_ARC 14
+#define DISPLAY_TEXT 15             // a[2]: offset of the string
+#define DISPLAY_BITMAP 16           // a[2]: index of the bitmap
+
+#define DISPLAY_MERGE_WINDOW 8      // earlier commands a rectangle may merge into
+
+#define OWN_COLOR -1                // draw(): the recorded colour
+
+
+DisplayList::DisplayList()
+{
+}
+
+/** Forget the recorded commands, the storage is kept for the next ones. */
+void DisplayList::clear()
+{
+    _commands.clear();
+    _text.clear();
+    _bitmaps.clear();
+}
+
+void DisplayList::add(int op, int color, int a0, int a1, int a2, int a3, int a4, int a5)
+{
+    DisplayCommand c;
+    c.op = op;
+    c.spare = 0;
+    c.color = color;
+    c.a[0] = a0;
+    c.a[1] = a1;
+    c.a[2] = a2;
+    c.a[3] = a3;
+    c.a[4] = a4;
+    c.a[5] = a5;
+    _commands.push_back(c);
+}
+
+void DisplayList::putPixel(int x, int y, int color)
+{
+    add(DISPLAY_PIXEL, color, x, y);
+}
+
+void DisplayList::rect(int x0, int y0, int x1, int y1, int color)
+{
+    add(DISPLAY_RECT, color, x0, y0, x1, y1);
+}
+
+void DisplayList::fillRect(int x0, int y0, int x1, int y1, int color)
+{
+    add(DISPLAY_FILL_RECT, color, x0, y0, x1, y1);
+}
+
+void DisplayList::line(int x0, int y0, int x1, int y1, int color)
+{
+    add(DISPLAY_LINE, color, x0, y0, x1, y1);
+}
+
+void DisplayList::lineAA(int x0, int y0, int x1, int y1, int color)
+{
+    add(DISPLAY_LINE_AA, color, x0, y0, x1, y1);
+}
+
+/** Corners on pixel centres, kept in sub-pixels like the driver does. */
+void DisplayList::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color)
+{
+    fillTriangleSub(x0 * RASTER_ONE + RASTER_HALF, y0 * RASTER_ONE + RASTER_HALF,
+                    x1 * RASTER_ONE + RASTER_HALF, y1 * RASTER_ONE + RASTER_HALF,
+                    x2 * RASTER_ONE + RASTER_HALF, y2 * RASTER_ONE + RASTER_HALF, color);
+}
+
+void DisplayList::fillTriangleSub(int x0, int y0, int x1, int y1, int x2, int y2, int color)
+{
+    add(DISPLAY_TRIANGLE, color, x0, y0, x1, y1, x2, y2);
+}
+
+void DisplayList::circle(int x0, int y0, int r, int color)
+{
+    add(DISPLAY_CIRCLE, color, x0, y0, r);
+}
+
+void DisplayList::fillCircle(int x0, int y0, int r, int color)
+{
+    add(DISPLAY_FILL_CIRCLE, color, x0, y0, r);
+}
+
+void DisplayList::ellipse(int x0, int y0, int rx, int ry, int color)
+{
+    add(DISPLAY_ELLIPSE, color, x0, y0, rx, ry);
+}
+
+void DisplayList::fillEllipse(int x0, int y0, int rx, int ry, int color)
+{
+    add(DISPLAY_FILL_ELLIPSE, color, x0, y0, rx, ry);
+}
+
+void DisplayList::roundRect(int x0, int y0, int x1, int y1, int r, int color)
+{
+    add(DISPLAY_ROUND_RECT, color, x0, y0, x1, y1, r);
+}
+
+void DisplayList::fillRoundRect(int x0, int y0, int x1, int y1, int r, int color)
+{
+    add(DISPLAY_FILL_ROUND_RECT, color, x0, y0, x1, y1, r);
+}
+
+void DisplayList::arc(int x0, int y0, int r, int start, int end, int color)
+{
+    add(DISPLAY_ARC, color, x0, y0, r, start, end);
+}
+
+void DisplayList::fillArc(int x0, int y0, int r0, int r1, int start, int end, int color)
+{
+    add(DISPLAY_FILL_ARC, color, x0, y0, r0, r1, start, end);
+}
+
+/** Text with its top left corner at x, y; the string is copied. */
+void DisplayList::drawString(int x, int y, const char* text, int color)
+{
+    int offset = _text.size();
+    _text.insert(_text.end(), text, text + strlen(text) + 1);
+    add(DISPLAY_TEXT, color, x, y, offset);
+}
+
+void DisplayList::drawBitmap(int x, int y, const Bitmap565& bitmap)
+{
+    add(DISPLAY_BITMAP, 0, x, y, _bitmaps.size());
+    _bitmaps.push_back(&bitmap);
+}
+
+// bounds of the extents around a centre
+static void centred(DisplayBounds& b, int x, int y, int rx, int ry)
+{
+    b.x0 = x - rx;
+    b.y0 = y - ry;
+    b.x1 = x + rx;
+    b.y1 = y + ry;
+}
+
+void DisplayList::bounds(const DisplayCommand& c, DisplayBounds& b)
+{
+    const int32_t* a = c.a;
+
+    switch (c.op) {
+        case DISPLAY_PIXEL:
+            b.x0 = b.x1 = a[0];
+            b.y0 = b.y1 = a[1];
+            break;
+
+        // the anti-aliased line blends inside its end points' box as well
+        case DISPLAY_RECT:
+        case DISPLAY_FILL_RECT:
+        case DISPLAY_LINE:
+        case DISPLAY_LINE_AA:
+        case DISPLAY_ROUND_RECT:
+        case DISPLAY_FILL_ROUND_RECT:
+            b.x0 = (a[0] < a[2]) ? a[0] : a[2];
+            b.x1 = (a[0] < a[2]) ? a[2] : a[0];
+            b.y0 = (a[1] < a[3]) ? a[1] : a[3];
+            b.y1 = (a[1] < a[3]) ? a[3] : a[1];
+            break;
+
+        case DISPLAY_TRIANGLE: {
+            int x0 = a[0], x1 = a[0], y0 = a[1], y1 = a[1];
+            for (int i = 2; i < 6; i += 2) {
+                if (a[i] < x0) x0 = a[i];
+                if (a[i] > x1) x1 = a[i];
+                if (a[i + 1] < y0) y0 = a[i + 1];
+                if (a[i + 1] > y1) y1 = a[i + 1];
+            }
+            b.x0 = RasterEdge::floorDiv(x0, RASTER_ONE);
+            b.y0 = RasterEdge::floorDiv(y0, RASTER_ONE);
+            b.x1 = RasterEdge::floorDiv(x1, RASTER_ONE);
+            b.y1 = RasterEdge::floorDiv(y1, RASTER_ONE);
+            break;
+        }
+
+        case DISPLAY_CIRCLE:
+        case DISPLAY_FILL_CIRCLE:
+        case DISPLAY_ARC:
+            centred(b, a[0], a[1], a[2], a[2]);
+            break;
+
+        case DISPLAY_ELLIPSE:
+        case DISPLAY_FILL_ELLIPSE:
+            centred(b, a[0], a[1], a[2], a[3]);
+            break;
+
+        case DISPLAY_FILL_ARC: {
+            int r = (a[2] > a[3]) ? a[2] : a[3];
+            centred(b, a[0], a[1], r, r);
+            break;
+        }
+
+        case DISPLAY_BITMAP: {
+            const Bitmap565* bitmap = _bitmaps[a[2]];
+            b.x0 = a[0];
+            b.y0 = a[1];
+            b.x1 = a[0] + bitmap->width - 1;
+            b.y1 = a[1] + bitmap->height - 1;
+            break;
+        }
+
+        // the extent of text depends on the font at replay time
+        default:
+            b.x0 = b.y0 = INT32_MIN;
+            b.x1 = b.y1 = INT32_MAX;
+            break;
+    }
+}
+
+static bool overlaps(const DisplayBounds& a, const DisplayBounds& b)
+{
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+static bool covers(const DisplayBounds& a, const DisplayBounds& b)
+{
+    return a.x0 <= b.x0 && a.x1 >= b.x1 && a.y0 <= b.y0 && a.y1 >= b.y1;
+}
+
+// the row sort order: top row, then left column
+static bool above(const DisplayBounds& a, const DisplayBounds& b)
+{
+    return a.y0 < b.y0 || (a.y0 == b.y0 && a.x0 < b.x0);
+}
+
+// rectangles that are one rectangle together
+static bool mergeable(const DisplayBounds& a, const DisplayBounds& b)
+{
+    if (a.x0 == b.x0 && a.x1 == b.x1) return b.y0 <= a.y1 + 1 && a.y0 <= b.y1 + 1;
+    if (a.y0 == b.y0 && a.y1 == b.y1) return b.x0 <= a.x1 + 1 && a.x0 <= b.x1 + 1;
+    return false;
+}
+
+static void unite(DisplayCommand& c, DisplayBounds& b, const DisplayBounds& other)
+{
+    if (other.x0 < b.x0) b.x0 = other.x0;
+    if (other.y0 < b.y0) b.y0 = other.y0;
+    if (other.x1 > b.x1) b.x1 = other.x1;
+    if (other.y1 > b.y1) b.y1 = other.y1;
+    c.a[0] = b.x0;
+    c.a[1] = b.y0;
+    c.a[2] = b.x1;
+    c.a[3] = b.y1;
+}
+
+// earlier rectangle of the first count that rectangle c merges into, -1
+// when there is none: c has to move up to it past commands it does not
+// overlap, then drawing both at once is exact
+int DisplayList::mergeTarget(int count, const DisplayCommand& c, const DisplayBounds& b)
+{
+    if (c.op != DISPLAY_FILL_RECT) return -1;
+
+    for (int k = count - 1; k >= 0 && k >= count - DISPLAY_MERGE_WINDOW; k--) {
+        const DisplayCommand& e = _commands[k];
+        if (e.op == DISPLAY_FILL_RECT && e.color == c.color && mergeable(_bounds[k], b)) return k;
+        if (overlaps(_bounds[k], b)) return -1;
+    }
+    return -1;
+}
+
+/** Rewrite the list into a shorter one drawing the same image, see the
+ * class description. Commands are compared by their bounding boxes, so
+ * one that only might overlap another keeps its place.
+ */
+void DisplayList::optimize()
+{
+    int n = _commands.size();
+    _bounds.resize(n);
+
+    // pixels and axis-aligned lines are rectangles; empty ones draw nothing
+    for (int i = 0; i < n; i++) {
+        DisplayCommand& c = _commands[i];
+        DisplayBounds& b = _bounds[i];
+        bounds(c, b);
+
+        bool straight = (c.op == DISPLAY_LINE && (c.a[0] == c.a[2] || c.a[1] == c.a[3]));
+        if (c.op == DISPLAY_PIXEL || straight) {
+            c.op = DISPLAY_FILL_RECT;
+            c.a[0] = b.x0;
+            c.a[1] = b.y0;
+            c.a[2] = b.x1;
+            c.a[3] = b.y1;
+        } else if (c.op == DISPLAY_FILL_RECT && (c.a[2] < c.a[0] || c.a[3] < c.a[1])) {
+            c.op = DISPLAY_NONE;
+        }
+    }
+
+    // a filled rectangle hides everything under it drawn before; the blend
+    // of a later anti-aliased line only reads its own pixels, so the ones
+    // in between lose nothing outside the rectangle
+    for (int j = n - 1; j > 0; j--) {
+        if (_commands[j].op != DISPLAY_FILL_RECT) continue;
+        for (int i = 0; i < j; i++) {
+            if (_commands[i].op != DISPLAY_NONE && covers(_bounds[j], _bounds[i])) {
+                _commands[i].op = DISPLAY_NONE;
+            }
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (_commands[i].op == DISPLAY_NONE) continue;
+        _commands[count] = _commands[i];
+        _bounds[count] = _bounds[i];
+        count++;
+    }
+    n = count;
+
+    // insertion sort by row: commands with disjoint bounds can swap places,
+    // one stops at the first command it overlaps
+    for (int i = 1; i < n; i++) {
+        DisplayCommand c = _commands[i];
+        DisplayBounds b = _bounds[i];
+        int j = i;
+        while (j > 0 && above(b, _bounds[j - 1]) && !overlaps(b, _bounds[j - 1])) {
+            _commands[j] = _commands[j - 1];
+            _bounds[j] = _bounds[j - 1];
+            j--;
+        }
+        _commands[j] = c;
+        _bounds[j] = b;
+    }
+
+    // the row order puts the spans of a shape a few commands apart; a
+    // grown last rectangle is tried again, so pixel runs become spans and
+    // spans become blocks
+    count = 0;
+    for (int i = 0; i < n; i++) {
+        DisplayCommand c = _commands[i];
+        DisplayBounds b = _bounds[i];
+        int k;
+        while ((k = mergeTarget(count, c, b)) >= 0) {
+            unite(_commands[k], _bounds[k], b);
+            if (k != count - 1) break;
+
+            count--;
+            c = _commands[count];
+            b = _bounds[count];
+        }
+        if (k >= 0) continue;
+
+        _commands[count] = c;
+        _bounds[count++] = b;
+    }
+    _commands.resize(count);
+}
+
+/** Draw the commands in their recorded colours. */
+void DisplayList::replay(ILI9341_Mbed* lcd)
+{
+    lcd->beginBatch();
+    for (size_t i = 0; i < _commands.size(); i++) {
+        draw(lcd, _commands[i], OWN_COLOR);
+    }
+    lcd->endBatch();
+}
+
+/** Draw every command in one colour, bitmaps as their box and anti-aliased
+ * lines as the three lines their blend covers: on a plain background this
+ * erases what replay() drew.
+ */
+void DisplayList::replay(ILI9341_Mbed* lcd, int color)
+{
+    lcd->beginBatch();
+    for (size_t i = 0; i < _commands.size(); i++) {
+        draw(lcd, _commands[i], color);
+    }
+    lcd->endBatch();
+}
+
+void DisplayList::draw(ILI9341_Mbed* lcd, const DisplayCommand& c, int color)
+{
+    const int32_t* a = c.a;
+    bool own = (color == OWN_COLOR);
+    if (own) color = c.color;
+
+    switch (c.op) {
+        case DISPLAY_PIXEL:
+            lcd->putPixel(a[0], a[1], color);
+            break;
+        case DISPLAY_RECT:
+            lcd->rect(a[0], a[1], a[2], a[3], color);
+            break;
+        case DISPLAY_FILL_RECT:
+            lcd->fillRect(a[0], a[1], a[2], a[3], color);
+            break;
+        case DISPLAY_LINE:
+            lcd->line(a[0], a[1], a[2], a[3], color);
+            break;
+        case DISPLAY_LINE_AA:
+            if (own) {
+                lcd->lineAA(a[0], a[1], a[2], a[3], color);
+            } else {
+                // the blend reaches one pixel either side across the line
+                int sx = (abs(a[2] - a[0]) < abs(a[3] - a[1])) ? 1 : 0;
+                lcd->line(a[0], a[1], a[2], a[3], color);
+                lcd->line(a[0] - sx, a[1] - 1 + sx, a[2] - sx, a[3] - 1 + sx, color);
+                lcd->line(a[0] + sx, a[1] + 1 - sx, a[2] + sx, a[3] + 1 - sx, color);
+            }
+            break;
+        case DISPLAY_TRIANGLE:
+            lcd->fillTriangleSub(a[0], a[1], a[2], a[3], a[4], a[5], color);
+            break;
+        case DISPLAY_CIRCLE:
+            lcd->circle(a[0], a[1], a[2], color);
+            break;
+        case DISPLAY_FILL_CIRCLE:
+            lcd->fillCircle(a[0], a[1], a[2], color);
+            break;
+        case DISPLAY_ELLIPSE:
+            lcd->ellipse(a[0], a[1], a[2], a[3], color);
+            break;
+        case DISPLAY_FILL_ELLIPSE:
+            lcd->fillEllipse(a[0], a[1], a[2], a[3], color);
+            break;
+        case DISPLAY_ROUND_RECT:
+            lcd->roundRect(a[0], a[1], a[2], a[3], a[4], color);
+            break;
+        case DISPLAY_FILL_ROUND_RECT:
+            lcd->fillRoundRect(a[0], a[1], a[2], a[3], a[4], color);
+            break;
+        case DISPLAY_ARC:
+            lcd->arc(a[0], a[1], a[2], a[3], a[4], color);
+            break;
+        case DISPLAY_FILL_ARC:
+            lcd->fillArc(a[0], a[1], a[2], a[3], a[4], a[5], color);
+            break;
+
+        // the caller's text colour and cursor are kept
+        case DISPLAY_TEXT: {
+            int foreground = lcd->getForeground();
+            int x, y;
+            lcd->getCursor(x, y);
+            lcd->foreground(color);
+            lcd->locate(a[0], a[1]);
+            lcd->drawString(&_text[a[2]]);
+            lcd->foreground(foreground);
+            lcd->locate(x, y);
+            break;
+        }
+
+        case DISPLAY_BITMAP: {
+            const Bitmap565* bitmap = _bitmaps[a[2]];
+            if (own) {
+                lcd->drawBitmap(a[0], a[1], *bitmap);
+            } else {
+                lcd->fillRect(a[0], a[1], a[0] + bitmap->width - 1, a[1] + bitmap->height - 1, color);
+            }
+            break;
+        }
+    }
+}
+
+int DisplayList::getCount()
+{
+    return _commands.size();
+}
+
+/** RAM the recorded commands and their strings take, with the slack of
+ * the storage kept for reuse.
+ */
+int DisplayList::getBytes()
+{
+    return sizeof(*this) + _commands.capacity() * sizeof(DisplayCommand) + _text.capacity() +
+           _bitmaps.capacity() * sizeof(const Bitmap565*) + _bounds.capacity() * sizeof(DisplayBounds);
+}
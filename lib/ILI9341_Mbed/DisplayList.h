@@ -0,0 +1,106 @@
+/* Recorded drawing commands for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include "mbed.h"
+#include "ILI9341_Mbed.h"
+#include <vector>
+
+/** One recorded primitive, 28 bytes. The operands are the arguments of the
+ * ILI9341_Mbed call in order; text and bitmaps keep an index into the
+ * list's text or bitmap storage.
+ */
+struct DisplayCommand
+{
+    int32_t a[6];
+    uint16_t color;
+    uint8_t op;
+    uint8_t spare;
+};
+
+/** Inclusive screen bounds of a command. */
+struct DisplayBounds
+{
+    int32_t x0, y0, x1, y1;
+};
+
+/** Display list: ILI9341_Mbed drawing calls recorded once and replayed.
+ *
+ * The recording methods take the arguments of the driver primitives of the
+ * same name. replay() draws the commands in order under one batch, with
+ * the driver's clip rectangle and frame buffer at that time; a static
+ * layer is recorded once and replayed every frame. Text is drawn with the
+ * driver's font and background at replay time and leaves the driver's text
+ * colour and cursor as they were, bitmaps are referenced and must outlive
+ * the list.
+ *
+ * optimize() rewrites the list into one that draws the same image:
+ * - commands a later filled rectangle covers completely are dropped,
+ * - commands move up in front of the ones they do not overlap, ordered by
+ *   their top row then left column, so the address window changes less,
+ * - horizontal and vertical lines and pixels become filled rectangles,
+ *   and neighbouring rectangles of one colour merge into one.
+ * Bounds are checked pairwise, it is meant for lists of a few hundred
+ * commands.
+ */
+class DisplayList
+{
+    private:
+        std::vector<DisplayCommand> _commands;
+        std::vector<char> _text;                    // zero terminated strings
+        std::vector<const Bitmap565*> _bitmaps;
+        std::vector<DisplayBounds> _bounds;         // optimize() work space
+
+    public:
+        DisplayList();
+
+        void clear();
+
+        void putPixel(int x, int y, int color);
+        void rect(int x0, int y0, int x1, int y1, int color);
+        void fillRect(int x0, int y0, int x1, int y1, int color);
+        void line(int x0, int y0, int x1, int y1, int color);
+        void lineAA(int x0, int y0, int x1, int y1, int color);
+        void fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color);
+        void fillTriangleSub(int x0, int y0, int x1, int y1, int x2, int y2, int color);
+
+        void circle(int x0, int y0, int r, int color);
+        void fillCircle(int x0, int y0, int r, int color);
+        void ellipse(int x0, int y0, int rx, int ry, int color);
+        void fillEllipse(int x0, int y0, int rx, int ry, int color);
+        void roundRect(int x0, int y0, int x1, int y1, int r, int color);
+        void fillRoundRect(int x0, int y0, int x1, int y1, int r, int color);
+        void arc(int x0, int y0, int r, int start, int end, int color);
+        void fillArc(int x0, int y0, int r0, int r1, int start, int end, int color);
+
+        void drawString(int x, int y, const char* text, int color);
+        void drawBitmap(int x, int y, const Bitmap565& bitmap);
+
+        void optimize();
+
+        void replay(ILI9341_Mbed* lcd);
+        void replay(ILI9341_Mbed* lcd, int color);
+
+        int getCount();
+        int getBytes();
+
+    private:
+        void add(int op, int color, int a0, int a1, int a2 = 0, int a3 = 0, int a4 = 0, int a5 = 0);
+        void bounds(const DisplayCommand& c, DisplayBounds& b);
+        int mergeTarget(int count, const DisplayCommand& c, const DisplayBounds& b);
+        void draw(ILI9341_Mbed* lcd, const DisplayCommand& c, int color);
+};
+
+#endif
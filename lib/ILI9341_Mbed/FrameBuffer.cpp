@@ -0,0 +1,403 @@
+/* Off-screen RGB565 frame buffer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "FrameBuffer.h"
+
+
+FrameBuffer::FrameBuffer(int width, int height, uint16_t* pixels)
+{
+    _width = width;
+    _height = height;
+    _originX = 0;
+    _originY = 0;
+
+    _ownsPixels = (pixels == NULL);
+    if (_ownsPixels) {
+        pixels = new uint16_t[width * height];
+    }
+    _pixels = pixels;
+    memset(_pixels, 0, width * height * sizeof(uint16_t));
+
+    _winX = _winY = _curX = _curY = 0;
+    _winW = _winH = 0;
+
+    clearDirty();
+    _usedX0 = _width;
+    _usedY0 = _height;
+    _usedX1 = -1;
+    _usedY1 = -1;
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    if (_ownsPixels) {
+        delete[] _pixels;
+    }
+}
+
+int FrameBuffer::getWidth()
+{
+    return _width;
+}
+
+int FrameBuffer::getHeight()
+{
+    return _height;
+}
+
+uint16_t* FrameBuffer::row(int y)
+{
+    return &_pixels[y * _width];
+}
+
+void FrameBuffer::setOrigin(int x, int y)
+{
+    _originX = x;
+    _originY = y;
+}
+
+int FrameBuffer::getOriginX()
+{
+    return _originX;
+}
+
+int FrameBuffer::getOriginY()
+{
+    return _originY;
+}
+
+void FrameBuffer::putPixel(int x, int y, int color)
+{
+    x -= _originX;
+    y -= _originY;
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+
+    _pixels[y * _width + x] = panelColor(color);
+    markDirty(x, y, x, y);
+    markUsed(x, y, x, y);
+}
+
+/** color over the pixel with alpha 0..ALPHA_OPAQUE, see blend565(). */
+void FrameBuffer::blendPixel(int x, int y, int color, int alpha)
+{
+    x -= _originX;
+    y -= _originY;
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+
+    uint16_t* p = &_pixels[y * _width + x];
+    *p = panelColor(blend565(color, panelColor(*p), alpha));
+    markDirty(x, y, x, y);
+    markUsed(x, y, x, y);
+}
+
+/** Anti-aliased line (Wu): every step of the major axis shares the colour
+ * between the two pixels next to the ideal line by their distance to it.
+ * Pixels outside the buffer are skipped, the damage is marked once.
+ */
+void FrameBuffer::lineAA(int x0, int y0, int x1, int y1, int color)
+{
+    lineAA(x0, y0, x1, y1, color, _originX, _originY, _originX + _width - 1, _originY + _height - 1);
+}
+
+// steps i whose minor offset (i * adjust) >> 16 lies in m0..m1, narrowed
+static void wuSteps(uint32_t adjust, int64_t m0, int64_t m1, int64_t& i0, int64_t& i1)
+{
+    if (adjust == 0) {
+        if (m0 > 0 || m1 < 0) i1 = i0 - 1;
+        return;
+    }
+    int64_t first = (m0 <= 0) ? 0 : ((m0 << 16) + adjust - 1) / adjust;
+    int64_t last = (((m1 + 1) << 16) + adjust - 1) / adjust - 1;
+    if (first > i0) i0 = first;
+    if (last < i1) i1 = last;
+}
+
+/** lineAA() blending only inside the screen rectangle clipX0..clipX1,
+ * clipY0..clipY1. The steps before the first pixel inside are skipped in
+ * closed form, so the pixels and shares are those of the whole line.
+ */
+void FrameBuffer::lineAA(int x0, int y0, int x1, int y1, int color, int clipX0, int clipY0, int clipX1, int clipY1)
+{
+    x0 -= _originX;
+    y0 -= _originY;
+    x1 -= _originX;
+    y1 -= _originY;
+
+    int wx0 = clipX0 - _originX, wy0 = clipY0 - _originY;
+    int wx1 = clipX1 - _originX, wy1 = clipY1 - _originY;
+    if (wx0 < 0) wx0 = 0;
+    if (wy0 < 0) wy0 = 0;
+    if (wx1 >= _width) wx1 = _width - 1;
+    if (wy1 >= _height) wy1 = _height - 1;
+
+    // top to bottom, so only x can run backwards
+    if (y0 > y1) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    int dx = x1 - x0, dy = y1 - y0;
+    int step = 1;
+    if (dx < 0) {
+        step = -1;
+        dx = -dx;
+    }
+
+    int bx0 = (step > 0) ? x0 : x1, bx1 = (step > 0) ? x1 : x0;
+    int by0 = y0, by1 = y1;
+    if (bx0 < wx0) bx0 = wx0;
+    if (by0 < wy0) by0 = wy0;
+    if (bx1 > wx1) bx1 = wx1;
+    if (by1 > wy1) by1 = wy1;
+    if (bx0 > bx1 || by0 > by1) return;
+    markDirty(bx0, by0, bx1, by1);
+    markUsed(bx0, by0, bx1, by1);
+
+    uint16_t fg = color;
+    unsigned int w = wx1 - wx0, h = wy1 - wy0;
+
+    #define LINE_AA_BLEND(px, py, a) \
+        if ((unsigned int)((px) - wx0) <= w && (unsigned int)((py) - wy0) <= h) { \
+            uint16_t* p = &_pixels[(py) * _width + (px)]; \
+            *p = panelColor(blend565(fg, panelColor(*p), a)); \
+        }
+
+    LINE_AA_BLEND(x0, y0, ALPHA_OPAQUE);
+    if (x1 != x0 || y1 != y0) LINE_AA_BLEND(x1, y1, ALPHA_OPAQUE);
+
+    // inner steps 1 .. major - 1, cut to the rows and columns a step can
+    // reach; its minor offset is (i * adjust) >> 16
+    int major = (dy > dx) ? dy : dx;
+    int64_t i0 = 1, i1 = major - 1;
+    uint32_t adjust = 0;
+    if (dx == dy) {
+        // diagonal, the step would overflow the accumulator
+        i0 = (wy0 - y0 > i0) ? wy0 - y0 : i0;
+        i1 = (wy1 - y0 < i1) ? wy1 - y0 : i1;
+        for (int64_t i = i0; i <= i1; i++) {
+            int x = x0 + step * (int)i;
+            LINE_AA_BLEND(x, y0 + (int)i, ALPHA_OPAQUE);
+        }
+    } else if (dy > dx) {
+        adjust = (uint32_t)(((uint64_t)dx << 16) / dy);
+        if (wy0 - y0 > i0) i0 = wy0 - y0;
+        if (wy1 - y0 < i1) i1 = wy1 - y0;
+        // the pixel or its partner one step further in the window
+        if (step > 0) wuSteps(adjust, (int64_t)wx0 - x0 - 1, (int64_t)wx1 - x0, i0, i1);
+        else wuSteps(adjust, (int64_t)x0 - wx1 - 1, (int64_t)x0 - wx0, i0, i1);
+    } else {
+        adjust = (uint32_t)(((uint64_t)dy << 16) / dx);
+        if (step > 0) {
+            if (wx0 - x0 > i0) i0 = wx0 - x0;
+            if (wx1 - x0 < i1) i1 = wx1 - x0;
+        } else {
+            if (x0 - wx1 > i0) i0 = x0 - wx1;
+            if (x0 - wx0 < i1) i1 = x0 - wx0;
+        }
+        wuSteps(adjust, (int64_t)wy0 - y0 - 1, (int64_t)wy1 - y0, i0, i1);
+    }
+
+    if (dx != dy && i0 <= i1) {
+        // 16 bit error accumulator: a carry moves the minor axis, its top 5
+        // bits are the share of the pixel on the far side of the line
+        uint64_t start = (uint64_t)(i0 - 1) * adjust;
+        uint16_t err = (uint16_t)start;
+        int minor = (int)(start >> 16);
+        int n = (int)(i1 - i0 + 1);
+
+        if (dy > dx) {
+            int x = x0 + step * minor, y = y0 + (int)i0 - 1;
+            while (n-- > 0) {
+                uint16_t last = err;
+                err += adjust;
+                if (err < last) x += step;
+                y++;
+
+                int alpha = err >> 11;
+                LINE_AA_BLEND(x, y, ALPHA_OPAQUE - alpha);
+                if (alpha) LINE_AA_BLEND(x + step, y, alpha);
+            }
+        } else {
+            int x = x0 + step * ((int)i0 - 1), y = y0 + minor;
+            while (n-- > 0) {
+                uint16_t last = err;
+                err += adjust;
+                if (err < last) y++;
+                x += step;
+
+                int alpha = err >> 11;
+                LINE_AA_BLEND(x, y, ALPHA_OPAQUE - alpha);
+                if (alpha) LINE_AA_BLEND(x, y + 1, alpha);
+            }
+        }
+    }
+
+    #undef LINE_AA_BLEND
+}
+
+void FrameBuffer::fill(int x, int y, int w, int h, int color)
+{
+    uint16_t c = panelColor(color);
+    x -= _originX;
+    y -= _originY;
+    int x1 = x + w - 1;
+    int y1 = y + h - 1;
+
+    // clip to the buffer
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 >= _width) x1 = _width - 1;
+    if (y1 >= _height) y1 = _height - 1;
+    if (x > x1 || y > y1) return;
+
+    for (int j = y; j <= y1; j++) {
+        fill565(row(j) + x, c, x1 - x + 1);
+    }
+    markDirty(x, y, x1, y1);
+    markUsed(x, y, x1, y1);
+}
+
+void FrameBuffer::clear(int color)
+{
+    if (_usedX0 > _usedX1) return;
+
+    uint16_t c = panelColor(color);
+    int x0 = _usedX0, y0 = _usedY0, x1 = _usedX1, y1 = _usedY1;
+    for (int j = y0; j <= y1; j++) {
+        fill565(row(j) + x0, c, x1 - x0 + 1);
+    }
+    markDirty(x0, y0, x1, y1);
+
+    _usedX0 = _width;
+    _usedY0 = _height;
+    _usedX1 = -1;
+    _usedY1 = -1;
+}
+
+void FrameBuffer::beginWrite(int x, int y, int w, int h)
+{
+    x -= _originX;
+    y -= _originY;
+    _winX = x;
+    _winY = y;
+    _winW = w;
+    _winH = h;
+    _curX = 0;
+    _curY = 0;
+
+    // the whole window is going to be written, mark its visible part
+    int x0 = (x < 0) ? 0 : x;
+    int y0 = (y < 0) ? 0 : y;
+    int x1 = (x + w > _width) ? _width - 1 : x + w - 1;
+    int y1 = (y + h > _height) ? _height - 1 : y + h - 1;
+    if (x0 <= x1 && y0 <= y1) {
+        markDirty(x0, y0, x1, y1);
+        markUsed(x0, y0, x1, y1);
+    }
+}
+
+void FrameBuffer::writeColor(int color, int count)
+{
+    uint16_t c = panelColor(color);
+
+    while (count > 0 && _curY < _winH) {
+        int n = _winW - _curX;
+        if (n > count) n = count;
+
+        int y = _winY + _curY;
+        if (y >= 0 && y < _height) {
+            int x0 = _winX + _curX;
+            int x1 = x0 + n;
+            if (x0 < 0) x0 = 0;
+            if (x1 > _width) x1 = _width;
+            if (x0 < x1) fill565(row(y) + x0, c, x1 - x0);
+        }
+
+        count -= n;
+        _curX += n;
+        if (_curX == _winW) {
+            _curX = 0;
+            _curY++;
+        }
+    }
+}
+
+void FrameBuffer::writePixels(const uint16_t* data, int count)
+{
+    while (count > 0 && _curY < _winH) {
+        int n = _winW - _curX;
+        if (n > count) n = count;
+
+        int y = _winY + _curY;
+        if (y >= 0 && y < _height) {
+            int x0 = _winX + _curX;
+            int x1 = x0 + n;
+            if (x0 < 0) x0 = 0;
+            if (x1 > _width) x1 = _width;
+            if (x0 < x1) swap565(row(y) + x0, data + (x0 - _winX - _curX), x1 - x0);
+        }
+
+        data += n;
+        count -= n;
+        _curX += n;
+        if (_curX == _winW) {
+            _curX = 0;
+            _curY++;
+        }
+    }
+}
+
+bool FrameBuffer::isDirty()
+{
+    return _dirtyX0 <= _dirtyX1;
+}
+
+void FrameBuffer::getDirty(int& x, int& y, int& w, int& h)
+{
+    x = _dirtyX0;
+    y = _dirtyY0;
+    w = _dirtyX1 - _dirtyX0 + 1;
+    h = _dirtyY1 - _dirtyY0 + 1;
+}
+
+void FrameBuffer::markDirty(int x0, int y0, int x1, int y1)
+{
+    if (x0 < _dirtyX0) _dirtyX0 = x0;
+    if (y0 < _dirtyY0) _dirtyY0 = y0;
+    if (x1 > _dirtyX1) _dirtyX1 = x1;
+    if (y1 > _dirtyY1) _dirtyY1 = y1;
+}
+
+void FrameBuffer::clearDirty()
+{
+    _dirtyX0 = _width;
+    _dirtyY0 = _height;
+    _dirtyX1 = -1;
+    _dirtyY1 = -1;
+}
+
+bool FrameBuffer::getUsed(int& x, int& y, int& w, int& h)
+{
+    x = _usedX0;
+    y = _usedY0;
+    w = _usedX1 - _usedX0 + 1;
+    h = _usedY1 - _usedY0 + 1;
+    return _usedX0 <= _usedX1;
+}
+
+void FrameBuffer::markUsed(int x0, int y0, int x1, int y1)
+{
+    if (x0 < _usedX0) _usedX0 = x0;
+    if (y0 < _usedY0) _usedY0 = y0;
+    if (x1 > _usedX1) _usedX1 = x1;
+    if (y1 > _usedY1) _usedY1 = y1;
+}
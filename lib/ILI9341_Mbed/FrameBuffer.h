@@ -0,0 +1,101 @@
+/* Off-screen RGB565 frame buffer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "mbed.h"
+#include "Pixel565.h"
+
+/** RGB565 colour in the byte order the panel takes it, MSB first. Stored
+ * like this a buffer goes out as plain 8 bit SPI bytes.
+ */
+inline uint16_t panelColor(int color)
+{
+    return ((color >> 8) & 0xFF) | ((color & 0xFF) << 8);
+}
+
+/** RAM copy of (part of) the panel in RGB565.
+ *
+ * Attach it with ILI9341_Mbed::setFrameBuffer() and every drawing primitive
+ * writes here instead of to the SPI bus. Two rectangles are tracked:
+ * the dirty area (changed since the last flush) and the used area (drawn
+ * since the last clear). clear() only wipes the used area, so a frame loop of
+ * clear() / draw / ILI9341_Mbed::flush() sends the union of the old and new
+ * image bounds and never needs an erase pass on the panel.
+ *
+ * Pixels are kept in panel byte order (see panelColor()).
+ *
+ * setOrigin() places the buffer anywhere on the panel: drawing takes panel
+ * coordinates, row(), the dirty and the used area are in buffer coordinates.
+ * A 320x16 buffer moved down the screen renders a frame band by band.
+ *
+ * A full 320x240 buffer needs 150 KB, more than the largest contiguous SRAM
+ * block of the STM32F407, so pass your own storage (or a smaller size) there.
+ */
+class FrameBuffer
+{
+    private:
+        uint16_t* _pixels;
+        bool _ownsPixels;
+        int _width;
+        int _height;
+        int _originX;
+        int _originY;
+
+        // inclusive bounds, empty when x0 > x1
+        int _dirtyX0, _dirtyY0, _dirtyX1, _dirtyY1;
+        int _usedX0, _usedY0, _usedX1, _usedY1;
+
+        // write window of beginWrite() and its cursor
+        int _winX, _winY, _winW, _winH;
+        int _curX, _curY;
+
+    public:
+        FrameBuffer(int width, int height, uint16_t* pixels = NULL);
+        ~FrameBuffer();
+
+        int getWidth();
+        int getHeight();
+        uint16_t* row(int y);
+
+        void setOrigin(int x, int y);
+        int getOriginX();
+        int getOriginY();
+
+    public:
+        void putPixel(int x, int y, int color);
+        void blendPixel(int x, int y, int color, int alpha);
+        void lineAA(int x0, int y0, int x1, int y1, int color);
+        void lineAA(int x0, int y0, int x1, int y1, int color, int clipX0, int clipY0, int clipX1, int clipY1);
+        void fill(int x, int y, int w, int h, int color);
+        void clear(int color);
+
+        // same streaming model as the panel's window + memory write
+        void beginWrite(int x, int y, int w, int h);
+        void writeColor(int color, int count);
+        void writePixels(const uint16_t* data, int count);
+
+    public:
+        bool isDirty();
+        void getDirty(int& x, int& y, int& w, int& h);
+        void markDirty(int x0, int y0, int x1, int y1);
+        void clearDirty();
+
+        bool getUsed(int& x, int& y, int& w, int& h);
+
+    private:
+        void markUsed(int x0, int y0, int x1, int y1);
+};
+
+#endif
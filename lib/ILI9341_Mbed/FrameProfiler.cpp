@@ -0,0 +1,159 @@
+/* Per-stage frame timing for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "FrameProfiler.h"
+#include "ILI9341_Mbed.h"
+
+#ifdef RENDER_PROFILE
+
+#if !(defined(DWT) && defined(CoreDebug))
+#include <chrono>
+#endif
+
+
+FrameProfiler::FrameProfiler()
+{
+    memset(&_frame, 0, sizeof(_frame));
+    memset(_start, 0, sizeof(_start));
+    memset(_depth, 0, sizeof(_depth));
+    _next = 0;
+    _count = 0;
+    _startBytes = 0;
+
+#if defined(DWT) && defined(CoreDebug)
+    // start the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+FrameProfiler& FrameProfiler::instance()
+{
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+uint32_t FrameProfiler::ticks()
+{
+#if defined(DWT) && defined(CoreDebug)
+    return DWT->CYCCNT;
+#else
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t FrameProfiler::ticksPerUs()
+{
+#if defined(DWT) && defined(CoreDebug)
+    return SystemCoreClock / 1000000;
+#else
+    return 1000;
+#endif
+}
+
+const char* FrameProfiler::stageName(int stage)
+{
+    static const char* const names[PROFILE_STAGES] = {
+        "frame", "setup", "xform", "raster", "driver", "flush"
+    };
+    return names[stage];
+}
+
+/** Start a frame, bytes is the SPI byte counter (BusStats) at its start. */
+void FrameProfiler::beginFrame(uint32_t bytes)
+{
+    memset(&_frame, 0, sizeof(_frame));
+    _startBytes = bytes;
+    begin(PROFILE_FRAME);
+}
+
+/** Close the frame, bytes is the SPI byte counter at its end. */
+void FrameProfiler::endFrame(uint32_t bytes)
+{
+    end(PROFILE_FRAME);
+    _frame.bytes = bytes - _startBytes;
+
+    _history[_next] = _frame;
+    _next = (_next + 1) % PROFILE_HISTORY;
+    if (_count < PROFILE_HISTORY) _count++;
+}
+
+void FrameProfiler::getSummary(ProfileSummary& summary)
+{
+    uint32_t perUs = ticksPerUs();
+
+    memset(&summary, 0, sizeof(summary));
+    summary.frames = _count;
+    if (_count == 0) return;
+
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        uint32_t lo = 0xFFFFFFFF, hi = 0;
+        uint64_t sum = 0;
+        for (int i = 0; i < _count; i++) {
+            uint32_t t = _history[i].ticks[s];
+            if (t < lo) lo = t;
+            if (t > hi) hi = t;
+            sum += t;
+        }
+        summary.minUs[s] = lo / perUs;
+        summary.maxUs[s] = hi / perUs;
+        summary.avgUs[s] = (uint32_t)(sum / _count / perUs);
+    }
+
+    uint64_t bytes = 0, primitives = 0;
+    for (int i = 0; i < _count; i++) {
+        bytes += _history[i].bytes;
+        primitives += _history[i].primitives;
+    }
+    summary.bytes = (uint32_t)(bytes / _count);
+    summary.primitives = (uint32_t)(primitives / _count);
+}
+
+/** Frame rate and average stage times as text at x, y. Drawn straight to
+ * the panel, bypassing an attached frame buffer so the overlay does not
+ * widen its damaged area.
+ */
+void FrameProfiler::drawOverlay(ILI9341_Mbed* lcd, int x, int y)
+{
+    ProfileSummary summary;
+    char text[32];
+
+    getSummary(summary);
+    if (summary.frames == 0) return;
+
+    FrameBuffer* fb = lcd->getFrameBuffer();
+    lcd->setFrameBuffer(NULL);
+    lcd->beginBatch();
+
+    int lines = PROFILE_STAGES + 1;
+    for (int l = 0; l < lines; l++) {
+        if (l == 0) {
+            uint32_t us = summary.avgUs[PROFILE_FRAME] ? summary.avgUs[PROFILE_FRAME] : 1;
+            snprintf(text, sizeof(text), "%3lu fps %5lu B", (unsigned long)(1000000 / us),
+                     (unsigned long)summary.bytes);
+        } else {
+            snprintf(text, sizeof(text), "%-6s %6lu us", stageName(l - 1),
+                     (unsigned long)summary.avgUs[l - 1]);
+        }
+
+        lcd->locate(x, y + l * 12);
+        lcd->drawString(text);
+    }
+
+    lcd->endBatch();
+    lcd->setFrameBuffer(fb);
+}
+
+#endif
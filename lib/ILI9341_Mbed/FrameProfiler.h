@@ -0,0 +1,142 @@
+/* Per-stage frame timing for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include "mbed.h"
+
+#define PROFILE_HISTORY 32      // frames kept for min/avg/max
+
+enum ProfileStage
+{
+    PROFILE_FRAME,          // beginFrame() .. endFrame()
+    PROFILE_SETUP,          // per frame matrices
+    PROFILE_TRANSFORM,      // vertex transforms
+    PROFILE_RASTER,         // culling, sorting and drawing calls
+    PROFILE_DRIVER,         // inside ILI9341_Mbed drawing primitives
+    PROFILE_FLUSH,          // sending off-screen buffers
+    PROFILE_STAGES
+};
+
+/** One frame of the history. */
+struct FrameProfile
+{
+    uint32_t ticks[PROFILE_STAGES];
+    uint32_t bytes;
+    uint32_t primitives;
+};
+
+/** Statistics over the frames in the history, times in microseconds. */
+struct ProfileSummary
+{
+    int frames;
+    uint32_t minUs[PROFILE_STAGES];
+    uint32_t avgUs[PROFILE_STAGES];
+    uint32_t maxUs[PROFILE_STAGES];
+    uint32_t bytes;         // average per frame
+    uint32_t primitives;    // average per frame
+};
+
+class ILI9341_Mbed;
+
+/** Frame time split into pipeline stages.
+ *
+ * Stages are timed with the DWT cycle counter on Cortex-M and
+ * std::chrono on the host. Nested begin()/end() pairs of one stage count
+ * once, so a primitive drawing through other primitives is timed and
+ * counted as one; every outermost PROFILE_DRIVER section is a primitive.
+ *
+ * Use the PROFILE_ macros: unless the build defines RENDER_PROFILE they are
+ * empty and nothing of this is compiled in.
+ */
+class FrameProfiler
+{
+    private:
+        FrameProfile _frame;
+        uint32_t _start[PROFILE_STAGES];
+        uint8_t _depth[PROFILE_STAGES];
+
+        FrameProfile _history[PROFILE_HISTORY];
+        int _next;
+        int _count;
+        uint32_t _startBytes;
+
+    public:
+        FrameProfiler();
+
+        static FrameProfiler& instance();
+
+        void beginFrame(uint32_t bytes);
+        void endFrame(uint32_t bytes);
+
+        void begin(ProfileStage stage)
+        {
+            if (_depth[stage]++ > 0) return;
+            if (stage == PROFILE_DRIVER) _frame.primitives++;
+            _start[stage] = ticks();
+        }
+
+        void end(ProfileStage stage)
+        {
+            if (--_depth[stage] > 0) return;
+            _frame.ticks[stage] += ticks() - _start[stage];
+        }
+
+        void getSummary(ProfileSummary& summary);
+        void drawOverlay(ILI9341_Mbed* lcd, int x, int y);
+
+        static const char* stageName(int stage);
+
+    private:
+        static uint32_t ticks();
+        static uint32_t ticksPerUs();
+};
+
+/** Times the rest of the enclosing block. */
+class ProfileScope
+{
+    private:
+        ProfileStage _stage;
+
+    public:
+        ProfileScope(ProfileStage stage) : _stage(stage)
+        {
+            FrameProfiler::instance().begin(stage);
+        }
+
+        ~ProfileScope()
+        {
+            FrameProfiler::instance().end(_stage);
+        }
+};
+
+#ifdef RENDER_PROFILE
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage)
+#define PROFILE_BEGIN(stage) FrameProfiler::instance().begin(stage)
+#define PROFILE_END(stage) FrameProfiler::instance().end(stage)
+#define PROFILE_BEGIN_FRAME(bytes) FrameProfiler::instance().beginFrame(bytes)
+#define PROFILE_END_FRAME(bytes) FrameProfiler::instance().endFrame(bytes)
+#define PROFILE_OVERLAY(lcd, x, y) FrameProfiler::instance().drawOverlay(lcd, x, y)
+#else
+#define PROFILE_SCOPE(stage)
+#define PROFILE_BEGIN(stage)
+#define PROFILE_END(stage)
+#define PROFILE_BEGIN_FRAME(bytes)
+#define PROFILE_END_FRAME(bytes)
+#define PROFILE_OVERLAY(lcd, x, y)
+#endif
+
+#endif
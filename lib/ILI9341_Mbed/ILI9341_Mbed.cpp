@@ -14,6 +14,10 @@
 #include "ILI9341_Mbed.h"
 #include "mbed.h"
 
+#define PIXELS_ALL 0            // beginPixels() window fully visible
+#define PIXELS_CLIPPED 1        // partly, only the visible pixels are sent
+#define PIXELS_NONE 2           // not at all
+
 
 ILI9341_Mbed::ILI9341_Mbed(SPI* spiInterface, DigitalOut* cs, DigitalOut* reset, DigitalOut* dc)
 {
@@ -23,38 +27,76 @@ ILI9341_Mbed::ILI9341_Mbed(SPI* spiInterface, DigitalOut* cs, DigitalOut* reset,
     _reset = reset;
 
     _orientation = 0;
+    resetClip();
+    _scrollTop = 0;
+    _scrollH = 0;
+    _pixMode = PIXELS_NONE;
     _char_x = 0;
     _char_y = 0;
+    _fontHeight = 0;
+    _glyphs = NULL;
+    _glyphBits = NULL;
+    _glcdGlyphs = NULL;
+    _glcdBits = NULL;
+    _foreground = White;
+    _background = Black;
+    _transparent = false;
+    _fb = NULL;
+
+    _txnLength = 0;
+    _txnCommands = 0;
+    _batchDepth = 0;
+    _csLevel = -1;
+    _dcLevel = -1;
+    memset(&_busStats, 0, sizeof(_busStats));
+
+#if DEVICE_SPI_ASYNCH
+    _asyncFb = NULL;
+    _asyncBusy = false;
+    memset(&_asyncStats, 0, sizeof(_asyncStats));
+#endif
 
     // setup spi
-    _cs->write(1);
+    setCs(1);
 	_spi->format(8, 3);
     _spi->frequency(10000000);          // 10 Mhz SPI clock
-    _cs->write(1);
     
     tftReset();
 }
 
+ILI9341_Mbed::~ILI9341_Mbed()
+{
+    delete[] _glcdGlyphs;
+    delete[] _glcdBits;
+}
+
 void ILI9341_Mbed::setOrientation(unsigned int orientation)
 {
+    char madctl = 0x48;
+
     _orientation = orientation;
-    writeCmd(0x36);
     switch (_orientation) {
         case 0:
-            _spi->write(0x48);
+            madctl = 0x48;
             break;
         case 1:
-            _spi->write(0x28);
+            madctl = 0x28;
             break;
         case 2:
-            _spi->write(0x88);
+            madctl = 0x88;
             break;
         case 3:
-            _spi->write(0xE8);
+            madctl = 0xE8;
             break;
     }
-    _cs->write(1); 
-    window(0, 0, getWidth(),  getHeight());
+
+    beginBatch();
+    resetScroll();
+    writeCmd(0x36);
+    writeData(&madctl, 1);
+    endBatch();
+
+    resetClip();
 }
 
 int ILI9341_Mbed::getWidth()
@@ -69,27 +111,112 @@ int ILI9341_Mbed::getHeight()
     else return TFT_WIDTH;
 }
 
+/** Scissor: every primitive only draws pixels inside x0..x1, y0..y1
+ * (inclusive, limited to the screen). Pixels outside cost no SPI traffic.
+ */
+void ILI9341_Mbed::setClip(int x0, int y0, int x1, int y1)
+{
+    _clipX0 = (x0 < 0) ? 0 : x0;
+    _clipY0 = (y0 < 0) ? 0 : y0;
+    _clipX1 = (x1 >= getWidth()) ? getWidth() - 1 : x1;
+    _clipY1 = (y1 >= getHeight()) ? getHeight() - 1 : y1;
+}
+
+void ILI9341_Mbed::getClip(int& x0, int& y0, int& x1, int& y1)
+{
+    x0 = _clipX0;
+    y0 = _clipY0;
+    x1 = _clipX1;
+    y1 = _clipY1;
+}
+
+/** Scissor back to the whole screen, also done by setOrientation(). */
+void ILI9341_Mbed::resetClip()
+{
+    setClip(0, 0, getWidth() - 1, getHeight() - 1);
+}
+
+/** Hardware vertical scrolling of rows y..y+h-1, the rows above and below
+ * stay fixed. The controller scrolls whole panel rows, which are screen
+ * rows in orientations 0 and 2 only: in 1 and 3 nothing is set and false
+ * is returned. setOrientation() ends the scrolling.
+ */
+bool ILI9341_Mbed::setScrollArea(int y, int h)
+{
+    if (_orientation == 1 || _orientation == 3) return false;
+    if (y < 0 || h <= 0 || y + h > getHeight()) return false;
+
+    // orientation 2 mirrors the rows (MY), the fixed areas swap
+    int top = (_orientation == 2) ? TFT_HEIGHT - y - h : y;
+    int bottom = TFT_HEIGHT - top - h;
+    char data[6] = { (char)(top >> 8), (char)top, (char)(h >> 8), (char)h, (char)(bottom >> 8), (char)bottom };
+
+    _scrollTop = top;
+    _scrollH = h;
+
+    beginBatch();
+    writeCmd(0x33);                     // vertical scrolling definition
+    writeData(data, 6);
+    scrollTo(0);
+    endBatch();
+    return true;
+}
+
+/** Show the scroll area's rows moved up by rows: screen row y + i of the
+ * area shows what was drawn at row y + (i + rows) mod h.
+ */
+void ILI9341_Mbed::scrollTo(int rows)
+{
+    if (_scrollH == 0) return;
+
+    rows %= _scrollH;
+    if (rows < 0) rows += _scrollH;
+
+    // mirrored rows scroll the other way through panel memory
+    int start = _scrollTop + ((_orientation == 2) ? (_scrollH - rows) % _scrollH : rows);
+    char data[2] = { (char)(start >> 8), (char)start };
+
+    beginBatch();
+    writeCmd(0x37);                     // vertical scrolling start address
+    writeData(data, 2);
+    endBatch();
+}
+
+/** Back to the unscrolled display, rows show what was drawn at them. */
+void ILI9341_Mbed::resetScroll()
+{
+    if (_scrollH == 0) return;
+
+    beginBatch();
+    scrollTo(0);
+    writeCmd(0x13);                     // normal display mode, ends scrolling
+    endBatch();
+    _scrollH = 0;
+}
+
 void ILI9341_Mbed::putPixel(int x, int y, int color)
 {
-    writeCmd(0x2A);
-    _spi->write(x >> 8);
-    _spi->write(x);
-    _cs->write(1);
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    if (x < _clipX0 || x > _clipX1 || y < _clipY0 || y > _clipY1) return;
 
-    writeCmd(0x2B);
-    _spi->write(y >> 8);
-    _spi->write(y);
-    _cs->write(1);
+    if (_fb) {
+        _fb->putPixel(x, y, color);
+        return;
+    }
+
+    beginBatch();
+    setColumns(x, x, false);
+    setPages(y, y, false);
 
     writeCmd(0x2C);
-    _spi->format(16,3);
-    _spi->write(color);
-    _spi->format(8,3);
-    _cs->write(1);
+    spiColor(color, 1);
+    endBatch();
 }
 
 void ILI9341_Mbed::rect(int x0, int y0, int x1, int y1, int color)
 {
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    beginBatch();
     if (x1 > x0) hline(x0,x1,y0,color);
     else  hline(x1,x0,y0,color);
 
@@ -101,114 +228,396 @@ void ILI9341_Mbed::rect(int x0, int y0, int x1, int y1, int color)
 
     if (y1 > y0) vline(x1,y0,y1,color);
     else vline(x1,y1,y0,color);
+    endBatch();
 
     return;
 }
 
 void ILI9341_Mbed::fillRect(int x0, int y0, int x1, int y1, int color)
 {
-
+    PROFILE_SCOPE(PROFILE_DRIVER);
     int h = y1 - y0 + 1;
     int w = x1 - x0 + 1;
-    int pixel = h * w;
-    window(x0, y0, w, h);
-    writeCmd(0x2C);
-    
-    _spi->format(16, 3);
 
-    for (int p=0; p<pixel; p++) {
-        _spi->write(color);
+    beginPixels(x0, y0, w, h);
+    pushColor(color, w * h);
+    endPixels();
+}
+
+#define CONIC_FILL 0
+#define CONIC_OUTLINE 1
+#define CONIC_RING 2
+
+// Half widths of the rows of an ellipse with half axes a, b. Pixel x of row
+// dy is inside when (2x)^2 (2b+1)^2 + (2dy)^2 (2a+1)^2 <= ((2a+1)(2b+1))^2,
+// the midpoint rule with the boundary half a pixel beyond the axes. The
+// width follows the row incrementally, so asking for rows in order costs
+// O(a) in total.
+struct ConicRows
+{
+    int64_t aa, bb, limit;
+    int x;
+
+    void init(int a, int b)
+    {
+        aa = (int64_t)(2 * a + 1) * (2 * a + 1);
+        bb = (int64_t)(2 * b + 1) * (2 * b + 1);
+        limit = (a < 0 || b < 0) ? -1 : aa * bb;
+        x = a;
     }
-    _spi->format(8, 3);
-    
-    _cs->write(1);
-    window(0, 0, getWidth(),  getHeight());
-    return;
+
+    bool inside(int px, int dy)
+    {
+        return 4 * (int64_t)px * px * bb + 4 * (int64_t)dy * dy * aa <= limit;
+    }
+
+    // rightmost pixel of the row, -1 when the row misses the ellipse
+    int width(int dy)
+    {
+        while (x >= 0 && !inside(x, dy)) x--;
+        while (inside(x + 1, dy)) x++;
+        return x;
+    }
+};
+
+/** Clockwise sector from start to end degrees, 0 pointing right. */
+struct ArcSector
+{
+    int sx, sy, ex, ey;
+    bool wide;              // more than half a turn
+
+    void init(int start, int end)
+    {
+        int sweep = (end - start) % 360;
+        if (sweep <= 0) sweep += 360;
+
+        const float rad = 3.14159265f / 180.0f;
+        sx = (int)floorf(cosf(start * rad) * 4096.0f + 0.5f);
+        sy = (int)floorf(sinf(start * rad) * 4096.0f + 0.5f);
+        ex = (int)floorf(cosf((start + sweep) * rad) * 4096.0f + 0.5f);
+        ey = (int)floorf(sinf((start + sweep) * rad) * 4096.0f + 0.5f);
+        wide = sweep > 180;
+    }
+
+    // cross products with y down: positive is clockwise on the screen
+    bool contains(int dx, int dy) const
+    {
+        if (wide) return !(ex * dy - ey * dx > 0 && dx * sy - dy * sx > 0);
+        return sx * dy - sy * dx >= 0 && dx * ey - dy * ex >= 0;
+    }
+};
+
+// Spans of one side of a shape; rows repeating the previous row's span
+// grow it into one rectangle, so straight parts are a single window
+struct RectMerge
+{
+    ILI9341_Mbed* lcd;
+    int color;
+    int x0, x1, y0, y1;
+
+    void add(int xa, int xb, int y)
+    {
+        if (y0 <= y1 && xa == x0 && xb == x1 && y == y1 + 1) {
+            y1 = y;
+            return;
+        }
+        flush();
+        x0 = xa;
+        x1 = xb;
+        y0 = y1 = y;
+    }
+
+    void flush()
+    {
+        if (y0 <= y1) lcd->fillRect(x0, y0, x1, y1, color);
+        y0 = 0;
+        y1 = -1;
+    }
+};
+
+// span xa..xb of row y, only the pixels in the sector around cx, cy
+static void sectorSpan(RectMerge& out, const ArcSector* sector, int cx, int cy, int xa, int xb, int y)
+{
+    if (!sector) {
+        out.add(xa, xb, y);
+        return;
+    }
+
+    int run = xa;
+    for (int x = xa; x <= xb; x++) {
+        if (sector->contains(x - cx, y - cy)) continue;
+        if (x > run) out.add(run, x - 1, y);
+        run = x + 1;
+    }
+    if (run <= xb) out.add(run, xb, y);
 }
 
-void ILI9341_Mbed::circle(int x0, int y0, int r, int color)
+/** Rows of a rounded box: the inner rectangle cx0..cx1, cy0..cy1 grown by
+ * quarter ellipses with half axes a, b. Every pixel goes out once as part
+ * of a horizontal span; a circle has cx0 == cx1 and cy0 == cy1.
+ *
+ * CONIC_FILL sends the whole rows, CONIC_OUTLINE the boundary pixels each
+ * row adds to its outer neighbour's, CONIC_RING what is outside a circle
+ * of radius hole around the same centre. A sector limits the pixels of a
+ * circle to an angle range.
+ */
+void ILI9341_Mbed::conicRows(int cx0, int cy0, int cx1, int cy1, int a, int b, int mode, int hole,
+                             const ArcSector* sector, int color)
 {
-    int x = -r, y = 0, err = 2-2*r, e2;
-    do {
-        putPixel(x0-x, y0+y,color);
-        putPixel(x0+x, y0+y,color);
-        putPixel(x0+x, y0-y,color);
-        putPixel(x0-x, y0-y,color);
-        e2 = err;
-        if (e2 <= y) {
-            err += ++y*2+1;
-            if (-x == y && e2 <= x) e2 = 0;
+    int top = (cy0 - b < _clipY0) ? _clipY0 : cy0 - b;
+    int bottom = (cy1 + b > _clipY1) ? _clipY1 : cy1 + b;
+    if (a < 0 || b < 0 || top > bottom) return;
+
+    ConicRows outer, next, inner;
+    outer.init(a, b);
+    next.init(a, b);
+    inner.init(hole, hole);
+
+    RectMerge left = { this, color, 0, 0, 0, -1 };
+    RectMerge right = { this, color, 0, 0, 0, -1 };
+
+    beginBatch();
+    for (int y = top; y <= bottom; y++) {
+        int dy = (y < cy0) ? cy0 - y : (y > cy1) ? y - cy1 : 0;
+        int hi = outer.width(dy);
+        if (hi < 0) continue;
+
+        // the straight sides between the corners only have their edge
+        bool side = (mode == CONIC_OUTLINE && y > cy0 && y < cy1);
+        int lo = 0;
+        if (mode == CONIC_OUTLINE) {
+            lo = side ? hi : next.width(dy + 1) + 1;
+            if (lo > hi) lo = hi;
+        } else if (mode == CONIC_RING) {
+            lo = inner.width(dy) + 1;
+            if (lo > hi) continue;
         }
-        if (e2 > x) err += ++x*2+1;
-    } while (x <= 0);
+
+        if ((lo <= 0 && !side) || cx1 + lo <= cx0 - lo) {
+            sectorSpan(left, sector, cx0, cy0, cx0 - hi, cx1 + hi, y);
+        } else {
+            sectorSpan(left, sector, cx0, cy0, cx0 - hi, cx0 - lo, y);
+            sectorSpan(right, sector, cx1, cy0, cx1 + lo, cx1 + hi, y);
+        }
+    }
+    left.flush();
+    right.flush();
+    endBatch();
+}
+
+void ILI9341_Mbed::circle(int x0, int y0, int r, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    conicRows(x0, y0, x0, y0, r, r, CONIC_OUTLINE, -1, NULL, color);
 }
 
 void ILI9341_Mbed::fillCircle(int x0, int y0, int r, int color)
 {
-    int x = -r, y = 0, err = 2-2*r, e2;
-    do {
-        vline(x0-x, y0-y, y0+y, color);
-        vline(x0+x, y0-y, y0+y, color);
-        e2 = err;
-        if (e2 <= y) {
-            err += ++y*2+1;
-            if (-x == y && e2 <= x) e2 = 0;
-        }
-        if (e2 > x) err += ++x*2+1;
-    } while (x <= 0);
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    conicRows(x0, y0, x0, y0, r, r, CONIC_FILL, -1, NULL, color);
+}
+
+void ILI9341_Mbed::ellipse(int x0, int y0, int rx, int ry, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    conicRows(x0, y0, x0, y0, rx, ry, CONIC_OUTLINE, -1, NULL, color);
+}
+
+void ILI9341_Mbed::fillEllipse(int x0, int y0, int rx, int ry, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    conicRows(x0, y0, x0, y0, rx, ry, CONIC_FILL, -1, NULL, color);
+}
+
+/** Rectangle with corners rounded to radius r, limited to half its size. */
+void ILI9341_Mbed::roundRect(int x0, int y0, int x1, int y1, int r, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    if (x1 < x0) { int t = x0; x0 = x1; x1 = t; }
+    if (y1 < y0) { int t = y0; y0 = y1; y1 = t; }
+    if (2 * r > x1 - x0) r = (x1 - x0) / 2;
+    if (2 * r > y1 - y0) r = (y1 - y0) / 2;
+    if (r < 0) r = 0;
+
+    conicRows(x0 + r, y0 + r, x1 - r, y1 - r, r, r, CONIC_OUTLINE, -1, NULL, color);
+}
+
+void ILI9341_Mbed::fillRoundRect(int x0, int y0, int x1, int y1, int r, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    if (x1 < x0) { int t = x0; x0 = x1; x1 = t; }
+    if (y1 < y0) { int t = y0; y0 = y1; y1 = t; }
+    if (2 * r > x1 - x0) r = (x1 - x0) / 2;
+    if (2 * r > y1 - y0) r = (y1 - y0) / 2;
+    if (r < 0) r = 0;
+
+    conicRows(x0 + r, y0 + r, x1 - r, y1 - r, r, r, CONIC_FILL, -1, NULL, color);
+}
+
+/** Part of a circle outline, clockwise from start to end degrees with 0
+ * pointing right; a sweep of 360 or more is the whole circle.
+ */
+void ILI9341_Mbed::arc(int x0, int y0, int r, int start, int end, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    ArcSector sector;
+    sector.init(start, end);
+    conicRows(x0, y0, x0, y0, r, r, CONIC_OUTLINE, -1, (end - start >= 360) ? NULL : &sector, color);
+}
+
+/** Ring segment between radius r0 and r1 (both included), angles as in
+ * arc(); the thick arcs of gauges and dials.
+ */
+void ILI9341_Mbed::fillArc(int x0, int y0, int r0, int r1, int start, int end, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    ArcSector sector;
+    sector.init(start, end);
+    conicRows(x0, y0, x0, y0, r1, r1, CONIC_RING, r0 - 1, (end - start >= 360) ? NULL : &sector, color);
 }
 
 void ILI9341_Mbed::hline(int x0, int x1, int y, int color)
 {
     int w;
     w = x1 - x0 + 1;
-    window(x0,y,w,1);
-    writeCmd(0x2C);  // send pixel
-    
-    _spi->format(16,3);                            // switch to 16 bit Mode 3
-    int j;
-    for (j=0; j<w; j++) {
-        _spi->write(color);
-    }
-    _spi->format(8,3);
-    
-    _cs->write(1);
-    window(0, 0, getWidth(),  getHeight());
-    return;
+
+    beginPixels(x0, y, w, 1);
+    pushColor(color, w);
+    endPixels();
 }
 
 void ILI9341_Mbed::vline(int x, int y0, int y1, int color)
 {
     int h;
     h = y1 - y0 + 1;
-    window(x,y0,1,h);
-    writeCmd(0x2C);  // send pixel
-    
-    _spi->format(16,3);                            // switch to 16 bit Mode 3
-    for (int y=0; y<h; y++) {
-        _spi->write(color);
-    }
-    _spi->format(8,3);    
-    _cs->write(1);
 
-    window(0, 0, getWidth(),  getHeight());
-    return;
+    beginPixels(x, y0, 1, h);
+    pushColor(color, h);
+    endPixels();
 }
 
+// run of a sliced line, ends given in drawing order
+void ILI9341_Mbed::hrun(int xa, int xb, int y, int color)
+{
+    if (xa == xb) putPixel(xa, y, color);
+    else if (xa < xb) hline(xa, xb, y, color);
+    else hline(xb, xa, y, color);
+}
+
+void ILI9341_Mbed::vrun(int x, int ya, int yb, int color)
+{
+    if (ya == yb) putPixel(x, ya, color);
+    else if (ya < yb) vline(x, ya, yb, color);
+    else vline(x, yb, ya, color);
+}
+
+/** Line cut to the scissor, with the pixels it has uncut. Lines with both
+ * end points on the outside of one edge are dropped at once.
+ */
 void ILI9341_Mbed::line(int x0, int y0, int x1, int y1, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    if (outCode(x0, y0) & outCode(x1, y1)) return;
+
+    beginBatch();
+    lineRuns(x0, y0, x1, y1, color);
+    endBatch();
+}
+
+/** Anti-aliased line, blended over what the attached FrameBuffer holds
+ * (see FrameBuffer::lineAA()). The panel cannot be read back, without a
+ * frame buffer it is a plain line().
+ */
+void ILI9341_Mbed::lineAA(int x0, int y0, int x1, int y1, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    if (!_fb) {
+        line(x0, y0, x1, y1, color);
+        return;
+    }
+
+    if (outCode(x0, y0) & outCode(x1, y1)) return;
+    _fb->lineAA(x0, y0, x1, y1, color, _clipX0, _clipY0, _clipX1, _clipY1);
+}
+
+#define OUT_LEFT 1
+#define OUT_RIGHT 2
+#define OUT_TOP 4
+#define OUT_BOTTOM 8
+
+// Cohen-Sutherland region of a point against the scissor
+int ILI9341_Mbed::outCode(int x, int y)
+{
+    int code = 0;
+    if (x < _clipX0) code |= OUT_LEFT;
+    else if (x > _clipX1) code |= OUT_RIGHT;
+    if (y < _clipY0) code |= OUT_TOP;
+    else if (y > _clipY1) code |= OUT_BOTTOM;
+    return code;
+}
+
+// Bresenham steps: a line of major * minor pixels has taken
+// (2 * minor * k + major) / (2 * major) minor steps at major step k
+static int64_t minorSteps(int64_t k, int64_t major, int64_t minor)
+{
+    return (2 * minor * k + major) / (2 * major);
+}
+
+// first major step with at least m minor steps
+static int64_t stepOfMinor(int64_t m, int64_t major, int64_t minor)
+{
+    if (m <= 0) return 0;
+    return (2 * major * m - major + 2 * minor - 1) / (2 * minor);
+}
+
+// major steps k0..k1 of a line from a along sign that stay in lo..hi
+static void stepsInside(int a, int sign, int lo, int hi, int64_t& k0, int64_t& k1)
+{
+    int64_t first = (sign > 0) ? (int64_t)lo - a : (int64_t)a - hi;
+    int64_t last = (sign > 0) ? (int64_t)hi - a : (int64_t)a - lo;
+    if (first > k0) k0 = first;
+    if (last < k1) k1 = last;
+}
+
+// major steps k0..k1 whose minor coordinate, from a along sign, is in lo..hi
+static void minorInside(int a, int sign, int lo, int hi, int64_t major, int64_t minor, int64_t& k0, int64_t& k1)
+{
+    int64_t m0 = (sign > 0) ? (int64_t)lo - a : (int64_t)a - hi;
+    int64_t m1 = (sign > 0) ? (int64_t)hi - a : (int64_t)a - lo;
+    if (m1 < 0 || m0 > minor) {
+        k1 = k0 - 1;
+        return;
+    }
+    int64_t first = stepOfMinor(m0, major, minor);
+    int64_t last = (m1 >= minor) ? major : stepOfMinor(m1 + 1, major, minor) - 1;
+    if (first > k0) k0 = first;
+    if (last < k1) k1 = last;
+}
+
+// Sliced Bresenham line. Only the steps inside the clip rectangle are
+// walked: the error term at any step is known in closed form, so a line
+// starts at its first visible pixel with the same pixels as if it had been
+// walked from its end point.
+void ILI9341_Mbed::lineRuns(int x0, int y0, int x1, int y1, int color)
 {
     //WindowMax();
     int   dx = 0, dy = 0;
     int   dx_sym = 0, dy_sym = 0;
     int   dx_x2 = 0, dy_x2 = 0;
     int   di = 0;
+    int   run = 0;
 
     dx = x1-x0;
     dy = y1-y0;
 
     if (dx == 0) {        /* vertical line */
-        if (y1 > y0) vline(x0,y0,y1,color);
-        else vline(x0,y1,y0,color);
+        if (x0 < _clipX0 || x0 > _clipX1) return;
+        if (y0 > y1) {
+            int t = y0; y0 = y1; y1 = t;
+        }
+        if (y0 < _clipY0) y0 = _clipY0;
+        if (y1 > _clipY1) y1 = _clipY1;
+        if (y0 <= y1) vline(x0,y0,y1,color);
         return;
     }
 
@@ -218,8 +627,13 @@ void ILI9341_Mbed::line(int x0, int y0, int x1, int y1, int color)
         dx_sym = -1;
     }
     if (dy == 0) {        /* horizontal line */
-        if (x1 > x0) hline(x0,x1,y0,color);
-        else  hline(x1,x0,y0,color);
+        if (y0 < _clipY0 || y0 > _clipY1) return;
+        if (x0 > x1) {
+            int t = x0; x0 = x1; x1 = t;
+        }
+        if (x0 < _clipX0) x0 = _clipX0;
+        if (x1 > _clipX1) x1 = _clipX1;
+        if (x0 <= x1) hline(x0,x1,y0,color);
         return;
     }
 
@@ -235,212 +649,349 @@ void ILI9341_Mbed::line(int x0, int y0, int x1, int y1, int color)
     dx_x2 = dx*2;
     dy_x2 = dy*2;
 
+    // run-slice: pixels sharing a row (or column) go out as one run,
+    // a run ends where the Bresenham error steps the minor axis
     if (dx >= dy) {
-        di = dy_x2 - dx;
-        while (x0 != x1) {
+        int64_t k0 = 0, k1 = dx;
+        stepsInside(x0, dx_sym, _clipX0, _clipX1, k0, k1);
+        minorInside(y0, dy_sym, _clipY0, _clipY1, dx, dy, k0, k1);
+        if (k0 > k1) return;
 
-            putPixel(x0, y0, color);
-            x0 += dx_sym;
-            if (di<0) {
+        int m = (int)minorSteps(k0, dx, dy);
+        di = (int)(dy_x2 * (k0 + 1) - dx - (int64_t)dx_x2 * m);
+        x1 = x0 + dx_sym * (int)k1;
+        x0 += dx_sym * (int)k0;
+        y0 += dy_sym * m;
+
+        run = x0;
+        while (x0 != x1) {
+            if (di < 0) {
                 di += dy_x2;
             } else {
                 di += dy_x2 - dx_x2;
+                hrun(run, x0, y0, color);
                 y0 += dy_sym;
+                run = x0 + dx_sym;
             }
+            x0 += dx_sym;
         }
-        putPixel(x0, y0, color);
+        hrun(run, x0, y0, color);
     } else {
-        di = dx_x2 - dy;
+        int64_t k0 = 0, k1 = dy;
+        stepsInside(y0, dy_sym, _clipY0, _clipY1, k0, k1);
+        minorInside(x0, dx_sym, _clipX0, _clipX1, dy, dx, k0, k1);
+        if (k0 > k1) return;
+
+        int m = (int)minorSteps(k0, dy, dx);
+        di = (int)(dx_x2 * (k0 + 1) - dy - (int64_t)dy_x2 * m);
+        y1 = y0 + dy_sym * (int)k1;
+        y0 += dy_sym * (int)k0;
+        x0 += dx_sym * m;
+
+        run = y0;
         while (y0 != y1) {
-            putPixel(x0, y0, color);
-            y0 += dy_sym;
             if (di < 0) {
                 di += dx_x2;
             } else {
                 di += dx_x2 - dy_x2;
+                vrun(x0, run, y0, color);
                 x0 += dx_sym;
+                run = y0 + dy_sym;
             }
+            y0 += dy_sym;
         }
-        putPixel(x0, y0, color);
+        vrun(x0, run, y0, color);
     }
     return;
 }
 
+// init sequence: command, number of parameters, parameters
+static const unsigned char initSequence[] = {
+    0xCF, 3, 0x00, 0x83, 0x30,              // POWER_CONTROL_B
+    0xED, 4, 0x64, 0x03, 0x12, 0x81,        // POWER_ON_SEQUENCE
+    0xE8, 3, 0x85, 0x01, 0x79,              // DRIVER_TIMING_A
+    0xCB, 5, 0x39, 0x2C, 0x00, 0x34, 0x02,  // POWER_CONTROL_A
+    0xF7, 1, 0x20,                          // PUMP_RATIO
+    0xEA, 2, 0x00, 0x00,                    // DRIVER_TIMING_B
+    0xC0, 1, 0x26,                          // POWER_CONTROL_1
+    0xC1, 1, 0x11,                          // POWER_CONTROL_2
+    0xC5, 2, 0x35, 0x3E,                    // VCOM_CONTROL_1
+    0xC7, 1, 0xBE,                          // VCOM_CONTROL_2
+    0x36, 1, 0x48,                          // MEMORY_ACCESS_CONTROL
+    0x3A, 1, 0x55,                          // COLMOD_PIXEL_FORMAT_SET
+    0xB1, 2, 0x00, 0x1B,                    // Frame Rate
+    0xF2, 1, 0x08,                          // Gamma Function Disable
+    0x26, 1, 0x01,                          // gamma set for curve 01/2/04/08
+    0xE0, 15,                               // positive gamma correction
+        0x1F, 0x1A, 0x18, 0x0A, 0x0F, 0x06, 0x45, 0x87,
+        0x32, 0x0A, 0x07, 0x02, 0x07, 0x05, 0x00,
+    0xE1, 15,                               // negativ gamma correction
+        0x00, 0x25, 0x27, 0x05, 0x10, 0x09, 0x3A, 0x78,
+        0x4D, 0x05, 0x18, 0x0D, 0x38, 0x3A, 0x1F,
+    0xB7, 1, 0x07,                          // entry mode
+    0xB6, 4, 0x0A, 0x82, 0x27, 0x00,        // display function control
+};
+
+// rasterizer spans into the driver, one window + burst each
+struct DriverSpan
+{
+    ILI9341_Mbed* lcd;
+    int color;
+
+    void operator()(int x0, int x1, int y)
+    {
+        lcd->fillRect(x0, y, x1, y, color);
+    }
+};
+
+/** Filled triangle, corners in pixels. */
+void ILI9341_Mbed::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    // integer corners sit on pixel centres
+    fillTriangleSub(x0 * RASTER_ONE + RASTER_HALF, y0 * RASTER_ONE + RASTER_HALF,
+                    x1 * RASTER_ONE + RASTER_HALF, y1 * RASTER_ONE + RASTER_HALF,
+                    x2 * RASTER_ONE + RASTER_HALF, y2 * RASTER_ONE + RASTER_HALF, color);
+}
+
+/** Filled triangle, corners in sub-pixel units (see rasterFixed()). */
+void ILI9341_Mbed::fillTriangleSub(int x0, int y0, int x1, int y1, int x2, int y2, int color)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    DriverSpan span = { this, color };
+
+    beginBatch();
+    rasterTriangle(x0, y0, x1, y1, x2, y2, span, _clipY0, _clipY1 + 1);
+    endBatch();
+}
+
+// rasterizer spans through the depth test, visible runs into the driver;
+// spans are cut to the scissor first so hidden columns keep their depth
+struct DepthSpan
+{
+    DepthBuffer* depth;
+    RasterPlane plane;
+    DriverSpan out;
+    int clipX0, clipX1;
+
+    void operator()(int x0, int x1, int y)
+    {
+        int32_t z = (int32_t)(plane.at(x0, y) * 256.0f);
+        int32_t dz = (int32_t)(plane.dx * 256.0f);
+        if (x0 < clipX0) {
+            z += dz * (clipX0 - x0);
+            x0 = clipX0;
+        }
+        if (x1 > clipX1) x1 = clipX1;
+        if (x0 > x1) return;
+        depth->testSpan(x0, x1, y, z, dz, out);
+    }
+};
+
+/** Filled triangle with depth test, corners in sub-pixel units and depth
+ * 0 (near) .. DEPTH_FAR. Only pixels nearer than the depth buffer are drawn.
+ */
+void ILI9341_Mbed::fillTriangleDepth(int x0, int y0, int z0, int x1, int y1, int z1, int x2, int y2, int z2,
+                                     int color, DepthBuffer* depth)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    DepthSpan span;
+    span.depth = depth;
+    span.out.lcd = this;
+    span.out.color = color;
+    span.clipX0 = _clipX0;
+    span.clipX1 = _clipX1;
+    if (!span.plane.init(x0, y0, z0, x1, y1, z1, x2, y2, z2)) return;
+
+    beginBatch();
+    rasterTriangle(x0, y0, x1, y1, x2, y2, span, _clipY0, _clipY1 + 1);
+    endBatch();
+}
+
 void ILI9341_Mbed::tftReset()
 {
-    _cs->write(1);
-    _dc->write(1);
+    _windowValid = false;
+
+    setCs(1);
+    setDc(1);
     _reset->write(0);
 
     wait_us(50);
     _reset->write(1);
 	thread_sleep_for(5);
-     
-    writeCmd(0x01);
-    
+
+    beginBatch();
+    writeCmd(0x01);                     // software reset
+    endBatch();
 	thread_sleep_for(5);
-    writeCmd(0x28);
-
-
-    /* Start Initial Sequence ----------------------------------------------------*/
-     writeCmd(0xCF);                     
-     _spi->write(0x00);
-     _spi->write(0x83);
-     _spi->write(0x30);
-     _cs->write(1);
-     
-     writeCmd(0xED);                     
-     _spi->write(0x64);
-     _spi->write(0x03);
-     _spi->write(0x12);
-     _spi->write(0x81);
-     _cs->write(1);
-     
-     writeCmd(0xE8);                     
-     _spi->write(0x85);
-     _spi->write(0x01);
-     _spi->write(0x79);
-     _cs->write(1);
-     
-     writeCmd(0xCB);                     
-     _spi->write(0x39);
-     _spi->write(0x2C);
-     _spi->write(0x00);
-     _spi->write(0x34);
-     _spi->write(0x02);
-     _cs->write(1);
-           
-     writeCmd(0xF7);                     
-     _spi->write(0x20);
-     _cs->write(1);
-           
-     writeCmd(0xEA);                     
-     _spi->write(0x00);
-     _spi->write(0x00);
-     _cs->write(1);
-     
-     writeCmd(0xC0);                     // POWER_CONTROL_1
-     _spi->write(0x26);
-     _cs->write(1);
- 
-     writeCmd(0xC1);                     // POWER_CONTROL_2
-     _spi->write(0x11);
-     _cs->write(1);
-     
-     writeCmd(0xC5);                     // VCOM_CONTROL_1
-     _spi->write(0x35);
-     _spi->write(0x3E);
-     _cs->write(1);
-     
-     writeCmd(0xC7);                     // VCOM_CONTROL_2
-     _spi->write(0xBE);
-     _cs->write(1);
-     
-     writeCmd(0x36);                     // MEMORY_ACCESS_CONTROL
-     _spi->write(0x48);
-     _cs->write(1);
-     
-     writeCmd(0x3A);                     // COLMOD_PIXEL_FORMAT_SET
-     _spi->write(0x55);                 // 16 bit pixel 
-     _cs->write(1);
-     
-     writeCmd(0xB1);                     // Frame Rate
-     _spi->write(0x00);
-     _spi->write(0x1B);               
-     _cs->write(1);
-     
-     writeCmd(0xF2);                     // Gamma Function Disable
-     _spi->write(0x08);
-     _cs->write(1);
-     
-     writeCmd(0x26);                     
-     _spi->write(0x01);                 // gamma set for curve 01/2/04/08
-     _cs->write(1);
-     
-     writeCmd(0xE0);                     // positive gamma correction
-     _spi->write(0x1F); 
-     _spi->write(0x1A); 
-     _spi->write(0x18); 
-     _spi->write(0x0A); 
-     _spi->write(0x0F); 
-     _spi->write(0x06); 
-     _spi->write(0x45); 
-     _spi->write(0x87); 
-     _spi->write(0x32); 
-     _spi->write(0x0A); 
-     _spi->write(0x07); 
-     _spi->write(0x02); 
-     _spi->write(0x07);
-     _spi->write(0x05); 
-     _spi->write(0x00);
-     _cs->write(1);
-     
-     writeCmd(0xE1);                     // negativ gamma correction
-     _spi->write(0x00); 
-     _spi->write(0x25); 
-     _spi->write(0x27); 
-     _spi->write(0x05); 
-     _spi->write(0x10); 
-     _spi->write(0x09); 
-     _spi->write(0x3A); 
-     _spi->write(0x78); 
-     _spi->write(0x4D); 
-     _spi->write(0x05); 
-     _spi->write(0x18); 
-     _spi->write(0x0D); 
-     _spi->write(0x38);
-     _spi->write(0x3A); 
-     _spi->write(0x1F);
-     _cs->write(1);
-     
-     
-     window(0, 0, getWidth(),  getHeight());
-     
-      
-     writeCmd(0xB7);                       // entry mode
-     _spi->write(0x07);
-     _cs->write(1);
-     
-     writeCmd(0xB6);                       // display function control
-     _spi->write(0x0A);
-     _spi->write(0x82);
-     _spi->write(0x27);
-     _spi->write(0x00);
-     _cs->write(1);
-     
-     writeCmd(0x11);                     // sleep out
-     _cs->write(1);
-     
-	 thread_sleep_for(100);
-     writeCmd(0x29);                     // display on
-     _cs->write(1);
-     
-	 thread_sleep_for(100);
+
+    // the whole configuration goes out under one chip select
+    beginBatch();
+    writeCmd(0x28);                     // display off
+    for (unsigned int i = 0; i < sizeof(initSequence); i += initSequence[i + 1] + 2) {
+        writeCmd(initSequence[i]);
+        writeData((const char*)&initSequence[i + 2], initSequence[i + 1]);
+    }
+    window(0, 0, getWidth(),  getHeight());
+    _windowValid = true;
+    writeCmd(0x11);                     // sleep out
+    endBatch();
+
+	thread_sleep_for(100);
+    beginBatch();
+    writeCmd(0x29);                     // display on
+    endBatch();
+
+	thread_sleep_for(100);
+}
+
+/** Transactions: command and parameter bytes are collected in _txn together
+ * with the positions where DC has to go low, and sent when the outermost
+ * endBatch() is reached, the buffer is full or bulk data follows. Chip
+ * select stays asserted for the whole batch and DC only changes where a
+ * command starts or ends.
+ */
+void ILI9341_Mbed::beginBatch()
+{
+    _batchDepth++;
+}
+
+void ILI9341_Mbed::endBatch()
+{
+    if (--_batchDepth > 0) return;
+
+    sendTxn();
+    setCs(1);
+}
+
+BusStats ILI9341_Mbed::getBusStats()
+{
+    return _busStats;
+}
+
+void ILI9341_Mbed::resetBusStats()
+{
+    memset(&_busStats, 0, sizeof(_busStats));
 }
 
 void ILI9341_Mbed::writeCmd(unsigned char cmd)
 {
-    _dc->write(0);
-    _cs->write(0);
-    _spi->write(cmd);
-    _dc->write(1);
+    if (_txnLength == TXN_BUFFER || _txnCommands == TXN_COMMANDS) sendTxn();
+
+    _txnCmd[_txnCommands++] = _txnLength;
+    _txn[_txnLength++] = cmd;
+}
+
+void ILI9341_Mbed::writeData(const char* data, int length)
+{
+    if (_txnLength + length > TXN_BUFFER) {
+        sendTxn();
+
+        if (length > TXN_BUFFER) {
+            // bulk data (pixels) is not copied, it goes straight out
+            startSend();
+            setDc(1);
+            _spi->write(data, length, NULL, 0);
+            _busStats.bytes += length;
+            return;
+        }
+    }
+
+    memcpy(&_txn[_txnLength], data, length);
+    _txnLength += length;
+}
+
+void ILI9341_Mbed::sendTxn()
+{
+    if (_txnLength == 0) return;
+
+    startSend();
+
+    int start = 0;
+    for (int i = 0; i < _txnCommands; i++) {
+        int cmd = _txnCmd[i];
+        if (cmd > start) {
+            setDc(1);
+            _spi->write(&_txn[start], cmd - start, NULL, 0);
+        }
+        setDc(0);
+        _spi->write(_txn[cmd]);
+        start = cmd + 1;
+    }
+    if (_txnLength > start) {
+        setDc(1);
+        _spi->write(&_txn[start], _txnLength - start, NULL, 0);
+    }
+
+    _busStats.bytes += _txnLength;
+    _txnLength = 0;
+    _txnCommands = 0;
+}
+
+void ILI9341_Mbed::startSend()
+{
+#if DEVICE_SPI_ASYNCH
+    waitIdle();     // a background transfer owns the bus until it is done
+#endif
+    setCs(0);
+}
+
+void ILI9341_Mbed::setCs(int level)
+{
+    if (level == _csLevel) return;
+
+    _cs->write(level);
+    _csLevel = level;
+    _busStats.gpioWrites++;
+    if (level == 0) _busStats.transactions++;
+}
+
+void ILI9341_Mbed::setDc(int level)
+{
+    if (level == _dcLevel) return;
+
+    _dc->write(level);
+    _dcLevel = level;
+    _busStats.gpioWrites++;
 }
 
 void ILI9341_Mbed::window(unsigned int x, unsigned int y, unsigned int w, unsigned int h)
 {
+    // a burst only wraps at the column end, and only if it has several rows
+    setColumns(x, x + w - 1, h > 1);
+    setPages(y, y + h - 1, false);
+}
+
+/** Column address set (0x2A), skipped when the controller already has it.
+ * If the end does not have to match exactly and the current one covers the
+ * range, the current end is kept. All four parameter bytes are always
+ * sent, the datasheet does not say a cut list keeps the old end.
+ */
+void ILI9341_Mbed::setColumns(unsigned int x0, unsigned int x1, bool exact)
+{
+    bool endOk = _windowValid && (_colEnd == x1 || (!exact && _colEnd >= x1));
+    if (endOk && _colStart == x0) return;
+    if (endOk) x1 = _colEnd;
+
+    char param[4] = { (char)(x0 >> 8), (char)x0, (char)(x1 >> 8), (char)x1 };
     writeCmd(0x2A);
-    _spi->write(x >> 8);
-    _spi->write(x);
-    _spi->write((x+w-1) >> 8);
-    _spi->write(x+w-1);
-    _cs->write(1);
+    writeData(param, 4);
+    _colStart = x0;
+    _colEnd = x1;
+}
 
+/** Page address set (0x2B), same rules as setColumns(). */
+void ILI9341_Mbed::setPages(unsigned int y0, unsigned int y1, bool exact)
+{
+    bool endOk = _windowValid && (_pageEnd == y1 || (!exact && _pageEnd >= y1));
+    if (endOk && _pageStart == y0) return;
+    if (endOk) y1 = _pageEnd;
+
+    char param[4] = { (char)(y0 >> 8), (char)y0, (char)(y1 >> 8), (char)y1 };
     writeCmd(0x2B);
-    _spi->write(y >> 8);
-    _spi->write(y);
-    _spi->write((y+h-1) >> 8);
-    _spi->write(y+h-1);
-    _cs->write(1);
+    writeData(param, 4);
+    _pageStart = y0;
+    _pageEnd = y1;
 }
 
 
@@ -451,57 +1002,579 @@ void ILI9341_Mbed::locate(int x, int y)
     _char_y = y;
 }
 
-void ILI9341_Mbed::set_font(unsigned char* f)
+void ILI9341_Mbed::getCursor(int& x, int& y)
+{
+    x = _char_x;
+    y = _char_y;
+}
+
+/** Font for the text functions, set_font() takes the packed fonts of the
+ * TFT_fonts headers (e.g. Arial12x12Packed).
+ */
+void ILI9341_Mbed::setFont(int height, const PackedGlyph* glyphs, const uint8_t* bitmap)
+{
+    _fontHeight = height;
+    _glyphs = glyphs;
+    _glyphBits = bitmap;
+}
+
+/** GLCD font as the TFT_fonts headers define it (e.g. Arial12x12). The
+ * glyphs are packed at run time into a heap copy; the constexpr packed
+ * fonts do the same at compile time and need no RAM.
+ */
+void ILI9341_Mbed::set_font(const unsigned char* f)
+{
+    delete[] _glcdGlyphs;
+    delete[] _glcdBits;
+
+    _glcdGlyphs = new PackedGlyph[PACKED_GLYPHS];
+    _glcdBits = new uint8_t[packedFontBytes(f)]();
+
+    size_t offset = 0;
+    for (int c = 0; c < PACKED_GLYPHS; c++) {
+        PackedGlyph g = glcdBox(f, c);
+        g.offset = offset;
+        _glcdGlyphs[c] = g;
+
+        for (int y = 0; y < g.rows; y++) {
+            for (int x = 0; x < g.width; x++) {
+                if (glcdPixel(f, c, g.left + x, g.top + y)) _glcdBits[offset + x / 8] |= 0x80 >> (x & 7);
+            }
+            offset += (g.width + 7) / 8;
+        }
+    }
+    setFont(f[2], _glcdGlyphs, _glcdBits);
+}
+
+void ILI9341_Mbed::foreground(int color)
+{
+    _foreground = color;
+}
+
+int ILI9341_Mbed::getForeground()
+{
+    return _foreground;
+}
+
+void ILI9341_Mbed::background(int color)
+{
+    _background = color;
+}
+
+/** In transparent mode text only draws its set pixels, the background is
+ * left as it is.
+ */
+void ILI9341_Mbed::setTransparent(bool transparent)
 {
-    font = f;
+    _transparent = transparent;
 }
 
+/** One character at the locate() position, see drawString(). */
 void ILI9341_Mbed::character(int x, int y, int c)
 {
-    unsigned int hor,vert,offset,bpl,j,i,b;
-    unsigned char* zeichen;
-    unsigned char z,w;
+    char text[2] = { (char)c, 0 };
+    drawString(text);
+}
+
+/** Text at the locate() position, which is advanced past it.
+ *
+ * Characters are laid out into runs that fit the current line; a run goes
+ * out as one window, rendered one pixel row at a time. Lines wrap at the
+ * screen edge and at '\n'.
+ */
+void ILI9341_Mbed::drawString(const char* text)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    if (!_glyphs) return;
+
+    beginBatch();
+    while (*text) {
+        const char* end = text;
+        int width = 0;
+        while (*end && *end != '\n' && _char_x + width + charWidth(*end) <= getWidth()) {
+            width += charWidth(*end);
+            end++;
+        }
+
+        if (width > 0) {
+            textRun(text, end - text, width);
+            _char_x += width;
+        }
+        if (*end == 0) break;
+
+        // a newline, or a character wider than the whole line, is consumed
+        if (*end == '\n' || (end == text && _char_x == 0)) end++;
+        newLine();
+        text = end;
+    }
+    endBatch();
+}
+
+int ILI9341_Mbed::getFontHeight()
+{
+    return _fontHeight;
+}
+
+/** Advance of a character in the current font, 0 for ones outside it. */
+int ILI9341_Mbed::charWidth(int c)
+{
+    if (c < PACKED_FIRST || c >= PACKED_FIRST + PACKED_GLYPHS) return 0;
+    return _glyphs[c - PACKED_FIRST].advance;
+}
 
-    if ((c < 31) || (c > 127)) return;   // test char range
+void ILI9341_Mbed::textRun(const char* text, int length, int width)
+{
+    uint16_t row[TFT_HEIGHT];            // one pixel row of the run
 
-    // read font parameter from start of array
-    offset = font[0];                    // bytes / char
-    hor = font[1];                       // get hor size of font
-    vert = font[2];                      // get vert size of font
-    bpl = font[3];                       // bytes per line
+    // transparent mode marks set pixels and sends their spans
+    uint16_t on = _transparent ? 1 : _foreground;
+    uint16_t off = _transparent ? 0 : _background;
 
-    if (_char_x + hor > getWidth()) {
-        _char_x = 0;
-        _char_y = _char_y + vert;
-        if (_char_y >= getHeight() - font[2]) {
-            _char_y = 0;
+    if (!_transparent) beginPixels(_char_x, _char_y, width, _fontHeight);
+    for (int j = 0; j < _fontHeight; j++) {
+        for (int i = 0; i < width; i++) {
+            row[i] = off;
+        }
+
+        int x = 0;
+        for (int k = 0; k < length; k++) {
+            int advance = charWidth(text[k]);
+            if (advance == 0) continue;
+
+            const PackedGlyph& g = _glyphs[text[k] - PACKED_FIRST];
+            int y = j - g.top;
+            if (y >= 0 && y < g.rows) {
+                // glyph rows are packed MSB first, 8 pixels per byte
+                int stride = (g.width + 7) >> 3;
+                const uint8_t* bits = &_glyphBits[g.offset + y * stride];
+                uint16_t* p = &row[x + g.left];
+                for (int n = 0; n < stride; n++, p += 8) {
+                    uint8_t b = bits[n];
+                    if (b == 0) continue;
+                    if (b & 0x80) p[0] = on;
+                    if (b & 0x40) p[1] = on;
+                    if (b & 0x20) p[2] = on;
+                    if (b & 0x10) p[3] = on;
+                    if (b & 0x08) p[4] = on;
+                    if (b & 0x04) p[5] = on;
+                    if (b & 0x02) p[6] = on;
+                    if (b & 0x01) p[7] = on;
+                }
+            }
+            x += advance;
+        }
+
+        if (!_transparent) {
+            pushPixels(row, width);
+            continue;
+        }
+
+        // transparent: only the spans of set pixels
+        for (int i = 0; i < width; i++) {
+            if (!row[i]) continue;
+            int first = i;
+            while (i + 1 < width && row[i + 1]) i++;
+            hline(_char_x + first, _char_x + i, _char_y + j, _foreground);
         }
     }
-    window(_char_x, _char_y, hor, vert); // char box
+    if (!_transparent) endPixels();
+}
+
+void ILI9341_Mbed::newLine()
+{
+    _char_x = 0;
+    _char_y += _fontHeight;
+    if (_char_y >= getHeight() - _fontHeight) {
+        _char_y = 0;
+    }
+}
+
+void ILI9341_Mbed::setFrameBuffer(FrameBuffer* fb)
+{
+    _fb = fb;
+}
+
+FrameBuffer* ILI9341_Mbed::getFrameBuffer()
+{
+    return _fb;
+}
+
+/** Send the damaged area of the frame buffer. Without one, send what the
+ * current batch has collected so far; chip select stays asserted.
+ */
+void ILI9341_Mbed::flush()
+{
+    if (!_fb) {
+        sendTxn();
+        return;
+    }
+    if (!_fb->isDirty()) return;
+
+    int x, y, w, h;
+    _fb->getDirty(x, y, w, h);
+
+    // one window and one memory write for the whole damaged area
+    beginBatch();
+    window(_fb->getOriginX() + x, _fb->getOriginY() + y, w, h);
+    writeCmd(0x2C);
+    for (int j = 0; j < h; j++) {
+        writeData((const char*)(_fb->row(y + j) + x), w * 2);
+    }
+    endBatch();
+
+    _fb->clearDirty();
+}
+
+/** Pixel stream: a window filled row by row with pushColor() / pushPixels().
+ * Only the part inside the scissor is sent; a window partly outside goes
+ * out as its visible rectangle with the other pixels skipped.
+ */
+void ILI9341_Mbed::beginPixels(int x, int y, int w, int h)
+{
+    int x0 = (x < _clipX0) ? _clipX0 : x;
+    int y0 = (y < _clipY0) ? _clipY0 : y;
+    int x1 = (x + w - 1 > _clipX1) ? _clipX1 : x + w - 1;
+    int y1 = (y + h - 1 > _clipY1) ? _clipY1 : y + h - 1;
+
+    if (w <= 0 || h <= 0 || x0 > x1 || y0 > y1) {
+        _pixMode = PIXELS_NONE;
+        return;
+    }
+
+    _pixMode = (x0 == x && y0 == y && x1 == x + w - 1 && y1 == y + h - 1) ? PIXELS_ALL : PIXELS_CLIPPED;
+    _pixX = x;
+    _pixY = y;
+    _pixW = w;
+    _pixH = h;
+    _pixCurX = 0;
+    _pixCurY = 0;
+    startPixels(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+void ILI9341_Mbed::pushColor(int color, int count)
+{
+    if (_pixMode == PIXELS_ALL) {
+        sendColor(color, count);
+        return;
+    }
+
+    while (_pixMode == PIXELS_CLIPPED && count > 0 && _pixCurY < _pixH) {
+        int n = _pixW - _pixCurX;
+        if (n > count) n = count;
+
+        int y = _pixY + _pixCurY;
+        int x0 = _pixX + _pixCurX;
+        int x1 = x0 + n - 1;
+        if (x0 < _clipX0) x0 = _clipX0;
+        if (x1 > _clipX1) x1 = _clipX1;
+        if (y >= _clipY0 && y <= _clipY1 && x0 <= x1) sendColor(color, x1 - x0 + 1);
+
+        count -= n;
+        _pixCurX += n;
+        if (_pixCurX == _pixW) {
+            _pixCurX = 0;
+            _pixCurY++;
+        }
+    }
+}
+
+void ILI9341_Mbed::pushPixels(const uint16_t* data, int count)
+{
+    if (_pixMode == PIXELS_ALL) {
+        sendPixels(data, count);
+        return;
+    }
+
+    while (_pixMode == PIXELS_CLIPPED && count > 0 && _pixCurY < _pixH) {
+        int n = _pixW - _pixCurX;
+        if (n > count) n = count;
+
+        int y = _pixY + _pixCurY;
+        int x0 = _pixX + _pixCurX;
+        int x1 = x0 + n - 1;
+        if (x0 < _clipX0) x0 = _clipX0;
+        if (x1 > _clipX1) x1 = _clipX1;
+        if (y >= _clipY0 && y <= _clipY1 && x0 <= x1) {
+            sendPixels(data + (x0 - _pixX - _pixCurX), x1 - x0 + 1);
+        }
+
+        data += n;
+        count -= n;
+        _pixCurX += n;
+        if (_pixCurX == _pixW) {
+            _pixCurX = 0;
+            _pixCurY++;
+        }
+    }
+}
+
+void ILI9341_Mbed::endPixels()
+{
+    if (_pixMode == PIXELS_NONE || _fb) return;
+
+    endBatch();
+}
+
+// visible rectangle of the stream to the frame buffer or the panel
+void ILI9341_Mbed::startPixels(int x, int y, int w, int h)
+{
+    if (_fb) {
+        _fb->beginWrite(x, y, w, h);
+        return;
+    }
+
+    beginBatch();
+    window(x, y, w, h);
     writeCmd(0x2C);  // send pixel
+}
 
-    _spi->format(16,3);   
+void ILI9341_Mbed::sendColor(int color, int count)
+{
+    if (_fb) {
+        _fb->writeColor(color, count);
+        return;
+    }
+    spiColor(color, count);
+}
 
-    zeichen = &font[((c -32) * offset) + 4]; // start of char bitmap
-    w = zeichen[0];                          // width of actual char
-     for (j=0; j<vert; j++) {  //  vert line
-        for (i=0; i<hor; i++) {   //  horz line
-            z =  zeichen[bpl * i + ((j & 0xF8) >> 3)+1];
-            b = 1 << (j & 0x07);
-            if (( z & b ) == 0x00) {
-                _spi->write(Black);
+void ILI9341_Mbed::sendPixels(const uint16_t* data, int count)
+{
+    if (_fb) {
+        _fb->writePixels(data, count);
+        return;
+    }
+    spiPixels(data, count);
+}
+
+/** Bitmap with its top left corner at x, y. Opaque bitmaps go out in one
+ * window burst, RLE runs straight from flash into the pixel stream; keyed
+ * bitmaps only send their opaque spans.
+ */
+void ILI9341_Mbed::drawBitmap(int x, int y, const Bitmap565& bitmap)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    int w = bitmap.width, h = bitmap.height;
+
+    if (bitmap.format == BITMAP_RAW) {
+        if (bitmap.keyed) drawBitmapKeyed(x, y, w, h, bitmap.data, bitmap.key);
+        else writePixels(x, y, w, h, bitmap.data);
+        return;
+    }
+
+    const uint16_t* run = bitmap.data;
+    beginBatch();
+    if (!bitmap.keyed) {
+        beginPixels(x, y, w, h);
+        for (int n = w * h; n > 0; ) {
+            int count = run[0] & BITMAP_COUNT;
+            if (run[0] & BITMAP_LITERAL) {
+                pushPixels(run + 1, count);
+                run += 1 + count;
             } else {
-                _spi->write(White);                
+                pushColor(run[1], count);
+                run += 2;
             }
+            n -= count;
         }
+        endPixels();
+        endBatch();
+        return;
     }
-    _cs->write(1);
-    _spi->format(8,3);
 
-    window (0, 0, getWidth(),  getHeight());
-    
-    if ((w + 2) < hor) 
-        _char_x += w + 2;
-    else 
-        _char_x += hor;
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; ) {
+            // transparent pixels are always repeat runs of the key
+            if (!(run[0] & BITMAP_LITERAL) && run[1] == bitmap.key) {
+                i += run[0] & BITMAP_COUNT;
+                run += 2;
+                continue;
+            }
+
+            // the opaque runs up to the next transparent one share a window
+            const uint16_t* end = run;
+            int span = 0;
+            while (i + span < w && ((end[0] & BITMAP_LITERAL) || end[1] != bitmap.key)) {
+                int count = end[0] & BITMAP_COUNT;
+                span += count;
+                end += (end[0] & BITMAP_LITERAL) ? 1 + count : 2;
+            }
+
+            beginPixels(x + i, y + j, span, 1);
+            for (; run < end; ) {
+                int count = run[0] & BITMAP_COUNT;
+                if (run[0] & BITMAP_LITERAL) {
+                    pushPixels(run + 1, count);
+                    run += 1 + count;
+                } else {
+                    pushColor(run[1], count);
+                    run += 2;
+                }
+            }
+            endPixels();
+            i += span;
+        }
+    }
+    endBatch();
+}
+
+/** Pixels with the colour key are left alone, every run of the others
+ * goes out as one span.
+ */
+void ILI9341_Mbed::drawBitmapKeyed(int x, int y, int w, int h, const uint16_t* pixels, uint16_t key)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    beginBatch();
+    for (int j = 0; j < h; j++, pixels += w) {
+        if (y + j < _clipY0 || y + j > _clipY1) continue;
+
+        int i = 0;
+        while (i < w) {
+            while (i < w && pixels[i] == key) i++;
+            int start = i;
+            while (i < w && pixels[i] != key) i++;
+            if (i > start) {
+                beginPixels(x + start, y + j, i - start, 1);
+                pushPixels(pixels + start, i - start);
+                endPixels();
+            }
+        }
+    }
+    endBatch();
+}
+
+void ILI9341_Mbed::writePixels(int x, int y, int w, int h, const uint16_t* data)
+{
+    PROFILE_SCOPE(PROFILE_DRIVER);
+    beginPixels(x, y, w, h);
+    pushPixels(data, w * h);
+    endPixels();
+}
+
+void ILI9341_Mbed::spiColor(int color, int count)
+{
+    // the panel takes RGB565 MSB first, so a 8 bit block transfer of
+    // big endian pairs replaces one 16 bit write call per pixel
+    uint16_t buf[PIXEL_CHUNK];
+    int n = (count < PIXEL_CHUNK) ? count : PIXEL_CHUNK;
+    fill565(buf, panelColor(color), n);
+
+    while (count > 0) {
+        n = (count < PIXEL_CHUNK) ? count : PIXEL_CHUNK;
+        writeData((const char*)buf, n * 2);
+        count -= n;
+    }
+}
+
+void ILI9341_Mbed::spiPixels(const uint16_t* data, int count)
+{
+    uint16_t buf[PIXEL_CHUNK];
+
+    while (count > 0) {
+        int n = (count < PIXEL_CHUNK) ? count : PIXEL_CHUNK;
+        swap565(buf, data, n);
+        writeData((const char*)buf, n * 2);
+        data += n;
+        count -= n;
+    }
+}
+
+#if DEVICE_SPI_ASYNCH
+/** Start sending the dirty area of the current frame buffer in the background.
+ * Rows are chained from the transfer complete interrupt; the frame buffer
+ * must not be drawn into until isBusy() returns false.
+ */
+void ILI9341_Mbed::flushAsync()
+{
+    if (!_fb || !_fb->isDirty()) return;
+
+    int x, y, w, h;
+    _fb->getDirty(x, y, w, h);
+
+    window(_fb->getOriginX() + x, _fb->getOriginY() + y, w, h);
+    writeCmd(0x2C);
+    sendTxn();
+    setDc(1);
+
+    _asyncFb = _fb;
+    _asyncX = x;
+    _asyncY = y;
+    _asyncW = w;
+    _asyncH = h;
+    _asyncRow = 0;
+    _asyncStart = us_ticker_read();
+    _asyncBusy = true;
+
+    _fb->clearDirty();
+
+    // chip select is released by asyncDone(), commands after this one
+    // wait for it in startSend() and assert it again
+    _csLevel = 1;
+    _busStats.gpioWrites++;
+    _busStats.bytes += w * h * 2;
+
+    asyncRow();
+}
+
+/** Ping-pong: send the current frame buffer and continue drawing into next.
+ * Waits for next to come off the wire first, so frame N+1 is drawn while
+ * frame N is transferred.
+ */
+void ILI9341_Mbed::swapBuffers(FrameBuffer* next)
+{
+    FrameBuffer* current = _fb;
+    int x, y, w, h;
+
+    waitIdle();
+
+    // next is flushed over the image of current, so it has to repaint it
+    if (current->getUsed(x, y, w, h)) {
+        next->markDirty(x, y, x + w - 1, y + h - 1);
+    }
+
+    flushAsync();
+    _fb = next;
+}
+
+bool ILI9341_Mbed::isBusy()
+{
+    return _asyncBusy;
+}
+
+void ILI9341_Mbed::waitIdle()
+{
+    if (_asyncBusy) {
+        uint32_t start = us_ticker_read();
+        while (_asyncBusy) {
+            ThisThread::yield();
+        }
+        _asyncStats.waitUs += us_ticker_read() - start;
+    }
+}
+
+AsyncStats ILI9341_Mbed::getAsyncStats()
+{
+    return _asyncStats;
+}
+
+void ILI9341_Mbed::asyncRow()
+{
+    // the buffer is in panel byte order, rows go out as they are
+    const char* p = (const char*)(_asyncFb->row(_asyncY + _asyncRow) + _asyncX);
+    _spi->transfer(p, _asyncW * 2, (char*)NULL, 0,
+                   callback(this, &ILI9341_Mbed::asyncDone), SPI_EVENT_COMPLETE);
+}
+
+void ILI9341_Mbed::asyncDone(int event)
+{
+    // interrupt context
+    if (++_asyncRow < _asyncH) {
+        asyncRow();
+        return;
+    }
+
+    _cs->write(1);
+    _asyncStats.transfers++;
+    _asyncStats.busyUs += us_ticker_read() - _asyncStart;
+    _asyncBusy = false;
 }
+#endif
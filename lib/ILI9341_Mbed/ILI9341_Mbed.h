@@ -15,10 +15,21 @@
 #define ILI9341_MBED_H
 
 #include "mbed.h"
+#include "FrameBuffer.h"
+#include "Rasterizer.h"
+#include "DepthBuffer.h"
+#include "FrameProfiler.h"
+#include "PackedFont.h"
+#include "Bitmap565.h"
+#include <atomic>
 
 #define TFT_WIDTH 240
 #define TFT_HEIGHT 320
 
+#define PIXEL_CHUNK 64          // pixels per SPI block transfer
+#define TXN_BUFFER 32           // command and parameter bytes per transaction
+#define TXN_COMMANDS 8          // commands per transaction
+
 #define RGB(r,g,b)  (((r&0xF8)<<8)|((g&0xFC)<<3)|((b&0xF8)>>3))
 
 #define Black           0x0000      /*   0,   0,   0 */
@@ -41,6 +52,29 @@
 #define GreenYellow     0xAFE5      /* 173, 255,  47 */
 
 
+/** SPI traffic since the last resetBusStats().
+ * gpioWrites counts the chip select and data/command level changes.
+ */
+struct ArcSector;
+
+struct BusStats
+{
+    uint32_t bytes;
+    uint32_t transactions;
+    uint32_t gpioWrites;
+};
+
+/** Time accounting of the asynchronous flushes.
+ * busyUs is the time frames spent on the wire, waitUs the part of it the CPU
+ * was blocked in waitIdle(); the difference was overlapped with other work.
+ */
+struct AsyncStats
+{
+    uint32_t transfers;
+    uint32_t busyUs;
+    uint32_t waitUs;
+};
+
 
 class ILI9341_Mbed
 {
@@ -55,17 +89,72 @@ class ILI9341_Mbed
         unsigned int _width;
         unsigned int _height;
 
-        unsigned int _char_x;
-        unsigned int _char_y;
+        int _char_x;
+        int _char_y;
+
+        // current font, see PackedFont.h
+        int _fontHeight;
+        const PackedGlyph* _glyphs;
+        const uint8_t* _glyphBits;
+        PackedGlyph* _glcdGlyphs;       // run-time packed copy, see set_font()
+        uint8_t* _glcdBits;
+        int _foreground;
+        int _background;
+        bool _transparent;
+
+        FrameBuffer* _fb;
+
+        // scissor rectangle, inclusive
+        int _clipX0, _clipY0, _clipX1, _clipY1;
+
+        // vertical scroll area in panel rows, none when _scrollH is 0
+        int _scrollTop, _scrollH;
+
+        // beginPixels() window, its cursor and how much of it is visible
+        int _pixX, _pixY, _pixW, _pixH;
+        int _pixCurX, _pixCurY;
+        int _pixMode;
+
+        // transaction buffer, _txnCmd holds the offsets of the command bytes
+        char _txn[TXN_BUFFER];
+        unsigned char _txnCmd[TXN_COMMANDS];
+        int _txnLength;
+        int _txnCommands;
+        int _batchDepth;
+        int _csLevel;
+        int _dcLevel;
+        BusStats _busStats;
 
-        unsigned char* font;
+        // address window the controller currently has
+        bool _windowValid;
+        unsigned int _colStart, _colEnd;
+        unsigned int _pageStart, _pageEnd;
+
+#if DEVICE_SPI_ASYNCH
+        // frame buffer area being sent by the background transfer
+        FrameBuffer* _asyncFb;
+        int _asyncX, _asyncY, _asyncW, _asyncH;
+        int _asyncRow;
+        std::atomic<bool> _asyncBusy;     // cleared by the transfer's completion
+        uint32_t _asyncStart;
+        AsyncStats _asyncStats;
+#endif
 
     public:
         ILI9341_Mbed(SPI* spiInterface, DigitalOut* cs, DigitalOut* reset, DigitalOut* dc);
+        ~ILI9341_Mbed();
 
         void setOrientation(unsigned int orientation);
         int getWidth();
         int getHeight();
+
+        void setClip(int x0, int y0, int x1, int y1);
+        void getClip(int& x0, int& y0, int& x1, int& y1);
+        void resetClip();
+
+        bool setScrollArea(int y, int h);
+        void scrollTo(int rows);
+        void resetScroll();
     
     public:
         void putPixel(int x, int y, int color);
@@ -75,23 +164,110 @@ class ILI9341_Mbed
         
         void circle(int x0, int y0, int r, int color);
         void fillCircle(int x0, int y0, int r, int color);
+        void ellipse(int x0, int y0, int rx, int ry, int color);
+        void fillEllipse(int x0, int y0, int rx, int ry, int color);
+        void roundRect(int x0, int y0, int x1, int y1, int r, int color);
+        void fillRoundRect(int x0, int y0, int x1, int y1, int r, int color);
+        void arc(int x0, int y0, int r, int start, int end, int color);
+        void fillArc(int x0, int y0, int r0, int r1, int start, int end, int color);
 
         void line(int x0, int y0, int x1, int y1, int color);
+        void lineAA(int x0, int y0, int x1, int y1, int color);
+
+        void fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color);
+        void fillTriangleSub(int x0, int y0, int x1, int y1, int x2, int y2, int color);
+        void fillTriangleDepth(int x0, int y0, int z0, int x1, int y1, int z1, int x2, int y2, int z2,
+                               int color, DepthBuffer* depth);
 
         void locate(int x, int y);
-        void set_font(unsigned char* f);
+        void getCursor(int& x, int& y);
+        template <size_t Bytes>
+        void set_font(const PackedFont<Bytes>& f)
+        {
+            setFont(f.height, f.glyphs, f.bitmap);
+        }
+        void set_font(const unsigned char* f);
+        void setFont(int height, const PackedGlyph* glyphs, const uint8_t* bitmap);
+        void foreground(int color);
+        int getForeground();
+        void background(int color);
+        void setTransparent(bool transparent);
+        int getFontHeight();
+        int charWidth(int c);
         void character(int x, int y, int c);
+        void drawString(const char* text);
+
+        void drawBitmap(int x, int y, const Bitmap565& bitmap);
+        void drawBitmapKeyed(int x, int y, int w, int h, const uint16_t* pixels, uint16_t key);
+
+    // bulk pixel streaming
+    public:
+        void writePixels(int x, int y, int w, int h, const uint16_t* data);
+
+        void beginPixels(int x, int y, int w, int h);
+        void pushColor(int color, int count);
+        void pushPixels(const uint16_t* data, int count);
+        void endPixels();
+
+    // transactions, nested batches share one chip select assertion
+    public:
+        void beginBatch();
+        void endBatch();
+
+        BusStats getBusStats();
+        void resetBusStats();
+
+    // off-screen rendering
+    public:
+        void setFrameBuffer(FrameBuffer* fb);
+        FrameBuffer* getFrameBuffer();
+        void flush();
+
+#if DEVICE_SPI_ASYNCH
+    // background transfer of frame buffers
+    public:
+        void flushAsync();
+        void swapBuffers(FrameBuffer* next);
+        bool isBusy();
+        void waitIdle();
+        AsyncStats getAsyncStats();
+#endif
     
     // private helpers
     private:
         void vline(int x, int y0, int y1, int color);
         void hline(int x0, int x1, int y, int color);
+        void lineRuns(int x0, int y0, int x1, int y1, int color);
+        int outCode(int x, int y);
+        void hrun(int xa, int xb, int y, int color);
+        void conicRows(int cx0, int cy0, int cx1, int cy1, int a, int b, int mode, int hole,
+                       const ArcSector* sector, int color);
+        void vrun(int x, int ya, int yb, int color);
+        void textRun(const char* text, int length, int width);
+        void newLine();
     
     // private driver methods
     private:
         void tftReset();
         void writeCmd(unsigned char cmd);
-        void window(unsigned int x, unsigned int y, unsigned int w, unsigned int h);        
+        void writeData(const char* data, int length);
+        void sendTxn();
+        void startSend();
+        void setCs(int level);
+        void setDc(int level);
+        void window(unsigned int x, unsigned int y, unsigned int w, unsigned int h);
+        void setColumns(unsigned int x0, unsigned int x1, bool exact);
+        void setPages(unsigned int y0, unsigned int y1, bool exact);
+        void spiColor(int color, int count);
+        void spiPixels(const uint16_t* data, int count);
+        void startPixels(int x, int y, int w, int h);
+        void sendColor(int color, int count);
+        void sendPixels(const uint16_t* data, int count);
+
+#if DEVICE_SPI_ASYNCH
+        void asyncRow();
+        void asyncDone(int event);
+#endif
 };
 
 #endif
\ No newline at end of file
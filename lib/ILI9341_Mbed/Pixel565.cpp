@@ -0,0 +1,174 @@
+/* RGB565 pixel kernels for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Pixel565.h"
+#include <string.h>
+
+// pixel pairs go through memcpy: one unaligned word load or store on the
+// Cortex-M4 and the host, without breaking strict aliasing
+static inline uint32_t loadPair(const uint16_t* p)
+{
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline void storePair(uint16_t* p, uint32_t w)
+{
+    memcpy(p, &w, sizeof(w));
+}
+
+void fill565(uint16_t* dst, uint16_t color, int count)
+{
+    // one pixel to reach a word boundary, then aligned pairs
+    if (count > 0 && ((uintptr_t)dst & 2)) {
+        *dst++ = color;
+        count--;
+    }
+
+    uint32_t pair = color | ((uint32_t)color << 16);
+    int pairs = count >> 1;
+    for (int i = 0; i < pairs; i++) {
+        storePair(dst + 2 * i, pair);
+    }
+    if (count & 1) dst[count - 1] = color;
+}
+
+void copy565(uint16_t* dst, const uint16_t* src, int count)
+{
+    int pairs = count >> 1;
+    for (int i = 0; i < pairs; i++) {
+        storePair(dst + 2 * i, loadPair(src + 2 * i));
+    }
+    if (count & 1) dst[count - 1] = src[count - 1];
+}
+
+void copyRect565(uint16_t* dst, int dstStride, const uint16_t* src, int srcStride, int w, int h)
+{
+    for (int j = 0; j < h; j++) {
+        copy565(dst, src, w);
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+// average of two pairs per channel: the shared bits plus half the differing
+// ones, with the lowest bit of each channel masked so nothing shifts across
+#define HALF_MASK 0xF7DEF7DE
+
+void blendHalf565(uint16_t* dst, const uint16_t* src, int count)
+{
+    int pairs = count >> 1;
+    for (int i = 0; i < pairs; i++) {
+        uint32_t a = loadPair(dst + 2 * i);
+        uint32_t b = loadPair(src + 2 * i);
+        storePair(dst + 2 * i, (a & b) + (((a ^ b) & HALF_MASK) >> 1));
+    }
+    if (count & 1) {
+        uint32_t a = dst[count - 1], b = src[count - 1];
+        dst[count - 1] = (a & b) + (((a ^ b) & HALF_MASK) >> 1);
+    }
+}
+
+void blendAlpha565(uint16_t* dst, const uint16_t* src, int alpha, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = blend565(src[i], dst[i], alpha);
+    }
+}
+
+void copyKey565(uint16_t* dst, const uint16_t* src, uint16_t key, int count)
+{
+    uint32_t keys = key | ((uint32_t)key << 16);
+    int pairs = count >> 1;
+    for (int i = 0; i < pairs; i++) {
+        uint32_t w = loadPair(src + 2 * i);
+        uint32_t x = w ^ keys;
+
+        // whole pairs are stored or skipped, only mixed ones split
+        if ((x & 0xFFFF) && (x >> 16)) {
+            storePair(dst + 2 * i, w);
+        } else if (x) {
+            if (x & 0xFFFF) dst[2 * i] = src[2 * i];
+            else dst[2 * i + 1] = src[2 * i + 1];
+        }
+    }
+    if ((count & 1) && src[count - 1] != key) dst[count - 1] = src[count - 1];
+}
+
+void swap565(uint16_t* dst, const uint16_t* src, int count)
+{
+    int pairs = count >> 1;
+    for (int i = 0; i < pairs; i++) {
+        uint32_t w = loadPair(src + 2 * i);
+        storePair(dst + 2 * i, ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF));
+    }
+    if (count & 1) {
+        uint16_t c = src[count - 1];
+        dst[count - 1] = (uint16_t)((c << 8) | (c >> 8));
+    }
+}
+
+void fill565Ref(uint16_t* dst, uint16_t color, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = color;
+    }
+}
+
+void copy565Ref(uint16_t* dst, const uint16_t* src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = src[i];
+    }
+}
+
+void copyRect565Ref(uint16_t* dst, int dstStride, const uint16_t* src, int srcStride, int w, int h)
+{
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            dst[j * dstStride + i] = src[j * srcStride + i];
+        }
+    }
+}
+
+void blendHalf565Ref(uint16_t* dst, const uint16_t* src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int r = (((dst[i] >> 11) & 0x1F) + ((src[i] >> 11) & 0x1F)) >> 1;
+        int g = (((dst[i] >> 5) & 0x3F) + ((src[i] >> 5) & 0x3F)) >> 1;
+        int b = ((dst[i] & 0x1F) + (src[i] & 0x1F)) >> 1;
+        dst[i] = (uint16_t)((r << 11) | (g << 5) | b);
+    }
+}
+
+void blendAlpha565Ref(uint16_t* dst, const uint16_t* src, int alpha, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = blend565Ref(src[i], dst[i], alpha);
+    }
+}
+
+void copyKey565Ref(uint16_t* dst, const uint16_t* src, uint16_t key, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (src[i] != key) dst[i] = src[i];
+    }
+}
+
+void swap565Ref(uint16_t* dst, const uint16_t* src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = (uint16_t)((src[i] << 8) | (src[i] >> 8));
+    }
+}
@@ -0,0 +1,67 @@
+/* RGB565 pixel kernels for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef PIXEL565_H
+#define PIXEL565_H
+
+#include <stdint.h>
+
+#define ALPHA_OPAQUE 32         // alpha scale of the blends, 0..32
+
+// green moved to the upper half word, each field with room to multiply
+#define SPREAD565 0x07E0F81F
+
+/** fg over bg with alpha 0..32, one multiply for all three channels:
+ * green is moved up so every field has 5 spare bits above it.
+ */
+inline uint16_t blend565(uint16_t fg, uint16_t bg, int alpha)
+{
+    uint32_t f = (fg | ((uint32_t)fg << 16)) & SPREAD565;
+    uint32_t b = (bg | ((uint32_t)bg << 16)) & SPREAD565;
+    uint32_t c = (b + (((f - b) * alpha) >> 5)) & SPREAD565;
+    return (uint16_t)(c | (c >> 16));
+}
+
+/** Channel by channel blend565(), the reference it is checked against. */
+inline uint16_t blend565Ref(uint16_t fg, uint16_t bg, int alpha)
+{
+    int r = (((fg >> 11) & 0x1F) * alpha + ((bg >> 11) & 0x1F) * (ALPHA_OPAQUE - alpha)) >> 5;
+    int g = (((fg >> 5) & 0x3F) * alpha + ((bg >> 5) & 0x3F) * (ALPHA_OPAQUE - alpha)) >> 5;
+    int b = ((fg & 0x1F) * alpha + (bg & 0x1F) * (ALPHA_OPAQUE - alpha)) >> 5;
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+/* Buffer kernels. They work on two pixels per 32 bit word, the loops are
+ * plain enough for the host compiler to widen them further. Every kernel
+ * has a ...Ref pixel by pixel version with the same result, used by the
+ * RENDER_BENCH checks. Byte order does not matter to fill, copy and the
+ * colour key; the blends take native RGB565, swap565() converts from and
+ * to the panel's MSB first order.
+ */
+void fill565(uint16_t* dst, uint16_t color, int count);
+void copy565(uint16_t* dst, const uint16_t* src, int count);
+void copyRect565(uint16_t* dst, int dstStride, const uint16_t* src, int srcStride, int w, int h);
+void blendHalf565(uint16_t* dst, const uint16_t* src, int count);
+void blendAlpha565(uint16_t* dst, const uint16_t* src, int alpha, int count);
+void copyKey565(uint16_t* dst, const uint16_t* src, uint16_t key, int count);
+void swap565(uint16_t* dst, const uint16_t* src, int count);
+
+void fill565Ref(uint16_t* dst, uint16_t color, int count);
+void copy565Ref(uint16_t* dst, const uint16_t* src, int count);
+void copyRect565Ref(uint16_t* dst, int dstStride, const uint16_t* src, int srcStride, int w, int h);
+void blendHalf565Ref(uint16_t* dst, const uint16_t* src, int count);
+void blendAlpha565Ref(uint16_t* dst, const uint16_t* src, int alpha, int count);
+void copyKey565Ref(uint16_t* dst, const uint16_t* src, uint16_t key, int count);
+void swap565Ref(uint16_t* dst, const uint16_t* src, int count);
+
+#endif
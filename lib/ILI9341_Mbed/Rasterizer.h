@@ -0,0 +1,176 @@
+/* Filled triangle rasterizer for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include "mbed.h"
+#include <limits.h>
+
+#define RASTER_SUBPIXEL_BITS 4
+#define RASTER_ONE (1 << RASTER_SUBPIXEL_BITS)
+#define RASTER_HALF (RASTER_ONE / 2)
+
+/** Float pixel coordinate to sub-pixel fixed point. */
+inline int rasterFixed(float v)
+{
+    return (int)floorf(v * RASTER_ONE + 0.5f);
+}
+
+/** Scanline crossing of one triangle edge.
+ *
+ * For the pixel centre row yc the edge function of (xa,ya)-(xb,yb) is zero at
+ * xa + (xb - xa) * (yc - ya) / (yb - ya). x is the first pixel whose centre is
+ * on or right of that point, kept exact as a quotient and remainder so
+ * stepping a row needs no division.
+ */
+struct RasterEdge
+{
+    int x;
+    int rem;
+    int stepX;
+    int stepRem;
+    int div;
+
+    void init(int xa, int ya, int xb, int yb, int row)
+    {
+        int dy = yb - ya;
+        int64_t n = (int64_t)(xb - xa) * (row * RASTER_ONE + RASTER_HALF - ya) + (int64_t)(xa - RASTER_HALF) * dy;
+
+        div = dy * RASTER_ONE;
+        x = (int)ceilDiv(n, div);
+        rem = (int)((int64_t)x * div - n);
+
+        int step = (xb - xa) * RASTER_ONE;
+        stepX = (int)floorDiv(step, div);
+        stepRem = step - stepX * div;
+    }
+
+    void step()
+    {
+        x += stepX;
+        rem -= stepRem;
+        if (rem < 0) {
+            rem += div;
+            x++;
+        }
+    }
+
+    static int64_t floorDiv(int64_t n, int64_t d)
+    {
+        int64_t q = n / d;
+        if ((n % d != 0) && ((n < 0) != (d < 0))) q--;
+        return q;
+    }
+
+    static int64_t ceilDiv(int64_t n, int64_t d)
+    {
+        return -floorDiv(-n, d);
+    }
+};
+
+/** Linear attribute (e.g. depth) over a triangle in screen space.
+ * Set up from the sub-pixel corners, evaluated at pixel centres.
+ */
+struct RasterPlane
+{
+    float z0;
+    float px0, py0;
+    float dx, dy;       // change per pixel
+
+    bool init(int x0, int y0, float za, int x1, int y1, float zb, int x2, int y2, float zc)
+    {
+        float cross = (float)(x1 - x0) * (y2 - y0) - (float)(x2 - x0) * (y1 - y0);
+        if (cross == 0.0f) return false;
+
+        dx = ((zb - za) * (y2 - y0) - (zc - za) * (y1 - y0)) / cross * RASTER_ONE;
+        dy = ((zc - za) * (x1 - x0) - (zb - za) * (x2 - x0)) / cross * RASTER_ONE;
+        z0 = za;
+        px0 = (float)x0 / RASTER_ONE;
+        py0 = (float)y0 / RASTER_ONE;
+        return true;
+    }
+
+    float at(int x, int y)
+    {
+        return z0 + dx * (x + 0.5f - px0) + dy * (y + 0.5f - py0);
+    }
+};
+
+/** Fill a triangle given in sub-pixel coordinates (RASTER_SUBPIXEL_BITS).
+ *
+ * A pixel is covered when its centre is inside the triangle. Centres exactly
+ * on an edge belong to the triangle only for top and left edges, so meshes
+ * sharing edges draw every pixel exactly once. The result is reported as
+ * horizontal spans to span(x0, x1, y) with inclusive ends; any functor works,
+ * e.g. one calling ILI9341_Mbed::fillRect() or FrameBuffer::fill().
+ *
+ * Only rows clipTop <= y < clipBottom are walked; edges are set up directly
+ * at the first visible row, so a band costs only the rows it covers.
+ */
+template <class Span>
+void rasterTriangle(int x0, int y0, int x1, int y1, int x2, int y2, Span& span,
+                    int clipTop, int clipBottom)
+{
+    int t;
+
+    // sort by y, v0 on top
+    if (y1 < y0) { t = x0; x0 = x1; x1 = t; t = y0; y0 = y1; y1 = t; }
+    if (y2 < y0) { t = x0; x0 = x2; x2 = t; t = y0; y0 = y2; y2 = t; }
+    if (y2 < y1) { t = x1; x1 = x2; x2 = t; t = y1; y1 = y2; y2 = t; }
+
+    // which side the long edge v0-v2 is on
+    int64_t cross = (int64_t)(x1 - x0) * (y2 - y0) - (int64_t)(x2 - x0) * (y1 - y0);
+    if (cross == 0) return;
+    bool longLeft = cross > 0;
+
+    // rows whose centre is in [y0, y2), top inclusive, bottom exclusive
+    int top = (int)RasterEdge::ceilDiv(y0 - RASTER_HALF, RASTER_ONE);
+    int mid = (int)RasterEdge::ceilDiv(y1 - RASTER_HALF, RASTER_ONE);
+    int bottom = (int)RasterEdge::ceilDiv(y2 - RASTER_HALF, RASTER_ONE);
+    if (top < clipTop) top = clipTop;
+    if (bottom > clipBottom) bottom = clipBottom;
+    if (mid < top) mid = top;
+    if (mid > bottom) mid = bottom;
+    if (top >= bottom) return;
+
+    RasterEdge longEdge, shortEdge;
+    longEdge.init(x0, y0, x2, y2, top);
+
+    for (int half = 0; half < 2; half++) {
+        int from = half ? mid : top;
+        int to = half ? bottom : mid;
+        if (from >= to) continue;
+
+        if (half) shortEdge.init(x1, y1, x2, y2, from);
+        else shortEdge.init(x0, y0, x1, y1, from);
+
+        RasterEdge& left = longLeft ? longEdge : shortEdge;
+        RasterEdge& right = longLeft ? shortEdge : longEdge;
+
+        for (int y = from; y < to; y++) {
+            // left edge inclusive, right edge exclusive
+            if (left.x < right.x) span(left.x, right.x - 1, y);
+            left.step();
+            right.step();
+        }
+    }
+}
+
+template <class Span>
+void rasterTriangle(int x0, int y0, int x1, int y1, int x2, int y2, Span& span)
+{
+    rasterTriangle(x0, y0, x1, y1, x2, y2, span, INT_MIN, INT_MAX);
+}
+
+#endif
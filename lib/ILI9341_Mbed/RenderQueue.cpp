@@ -0,0 +1,91 @@
+/* Screen space primitive queue between rendering threads.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "RenderQueue.h"
+
+
+RenderQueue::RenderQueue() : _head(0), _tail(0), _fullUs(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void RenderQueue::pushLine(int x0, int y0, int x1, int y1, int color)
+{
+    RenderPrimitive p;
+    p.type = PRIMITIVE_LINE;
+    p.color = color;
+    p.x[0] = x0;
+    p.y[0] = y0;
+    p.x[1] = x1;
+    p.y[1] = y1;
+    push(p);
+}
+
+void RenderQueue::pushTriangle(int x0, int y0, int z0, int x1, int y1, int z1, int x2, int y2, int z2,
+                               int color)
+{
+    RenderPrimitive p;
+    p.type = PRIMITIVE_TRIANGLE;
+    p.color = color;
+    p.x[0] = x0;
+    p.y[0] = y0;
+    p.z[0] = z0;
+    p.x[1] = x1;
+    p.y[1] = y1;
+    p.z[1] = z1;
+    p.x[2] = x2;
+    p.y[2] = y2;
+    p.z[2] = z2;
+    push(p);
+}
+
+void RenderQueue::pushFrameEnd()
+{
+    RenderPrimitive p;
+    p.type = PRIMITIVE_FRAME_END;
+    push(p);
+}
+
+// the consumer is behind, let it run until a slot is free
+void RenderQueue::waitRoom(uint32_t head)
+{
+    uint32_t start = us_ticker_read();
+    while (head - _tail.load(std::memory_order_acquire) == RENDER_QUEUE_SIZE) {
+        ThisThread::yield();
+    }
+    _fullUs.fetch_add(us_ticker_read() - start, std::memory_order_relaxed);
+}
+
+// the producer is behind, let it run until it has queued something
+uint32_t RenderQueue::waitItems(uint32_t tail)
+{
+    uint32_t start = us_ticker_read();
+    uint32_t depth;
+    while ((depth = _head.load(std::memory_order_acquire) - tail) == 0) {
+        ThisThread::yield();
+    }
+    _stats.emptyUs += us_ticker_read() - start;
+    return depth;
+}
+
+void RenderQueue::getStats(QueueStats& stats)
+{
+    stats = _stats;
+    stats.fullUs = _fullUs.load(std::memory_order_relaxed);
+}
+
+void RenderQueue::resetStats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _fullUs.store(0, std::memory_order_relaxed);
+}
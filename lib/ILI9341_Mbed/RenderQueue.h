@@ -0,0 +1,108 @@
+/* Screen space primitive queue between rendering threads.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "mbed.h"
+#include <atomic>
+
+#ifndef RENDER_QUEUE_SIZE
+#define RENDER_QUEUE_SIZE 64    // primitives in flight, a power of two
+#endif
+
+#define PRIMITIVE_LINE 0            // end points in pixels
+#define PRIMITIVE_TRIANGLE 1        // corners in sub-pixels, with depth values
+#define PRIMITIVE_FRAME_END 2
+
+/** One screen space primitive, or the end of a frame. */
+struct RenderPrimitive
+{
+    int32_t x[3];
+    int32_t y[3];
+    uint16_t z[3];
+    uint16_t color;
+    uint8_t type;
+};
+
+/** Queue use since the last resetStats(). depthSum / pops is the average
+ * number of primitives waiting when the consumer takes one.
+ */
+struct QueueStats
+{
+    uint32_t frames;
+    uint32_t pops;
+    uint32_t depthSum;
+    uint32_t maxDepth;
+    uint32_t fullUs;        // producer waiting for room: output bound
+    uint32_t emptyUs;       // consumer waiting for primitives: geometry bound
+};
+
+/** Lock-free single producer, single consumer ring of primitives.
+ *
+ * One thread push()es, another pop()s. Each index is written by one side
+ * only and published with release/acquire ordering, so no lock or
+ * critical section is needed. A side that finds the ring full or empty
+ * yields to the other thread until it can go on; the time it waited is
+ * counted. getStats() and resetStats() belong to the consumer.
+ */
+class RenderQueue
+{
+    private:
+        RenderPrimitive _items[RENDER_QUEUE_SIZE];
+        std::atomic<uint32_t> _head;        // next to write, producer side
+        std::atomic<uint32_t> _tail;        // next to read, consumer side
+        std::atomic<uint32_t> _fullUs;
+
+        QueueStats _stats;
+
+    public:
+        RenderQueue();
+
+        void push(const RenderPrimitive& p)
+        {
+            uint32_t head = _head.load(std::memory_order_relaxed);
+            if (head - _tail.load(std::memory_order_acquire) == RENDER_QUEUE_SIZE) waitRoom(head);
+
+            _items[head & (RENDER_QUEUE_SIZE - 1)] = p;
+            _head.store(head + 1, std::memory_order_release);
+        }
+
+        void pop(RenderPrimitive& p)
+        {
+            uint32_t tail = _tail.load(std::memory_order_relaxed);
+            uint32_t depth = _head.load(std::memory_order_acquire) - tail;
+            if (depth == 0) depth = waitItems(tail);
+
+            p = _items[tail & (RENDER_QUEUE_SIZE - 1)];
+            _tail.store(tail + 1, std::memory_order_release);
+
+            _stats.pops++;
+            _stats.depthSum += depth;
+            if (depth > _stats.maxDepth) _stats.maxDepth = depth;
+            if (p.type == PRIMITIVE_FRAME_END) _stats.frames++;
+        }
+
+        void pushLine(int x0, int y0, int x1, int y1, int color);
+        void pushTriangle(int x0, int y0, int z0, int x1, int y1, int z1, int x2, int y2, int z2, int color);
+        void pushFrameEnd();
+
+        void getStats(QueueStats& stats);
+        void resetStats();
+
+    private:
+        void waitRoom(uint32_t head);
+        uint32_t waitItems(uint32_t tail);
+};
+
+#endif
@@ -0,0 +1,146 @@
+/* Scrolling text console for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "TextConsole.h"
+
+
+/** Console in x, y, w, h: as many lines of the current font as fit. */
+TextConsole::TextConsole(ILI9341_Mbed* lcd, int x, int y, int w, int h, int foreground, int background)
+{
+    _lcd = lcd;
+    _x = x;
+    _y = y;
+    _w = w;
+    _foreground = foreground;
+    _background = background;
+
+    _lineHeight = lcd->getFontHeight() > 0 ? lcd->getFontHeight() : 1;
+    _lines = h / _lineHeight;
+    if (_lines < 1) _lines = 1;
+
+    // the panel scrolls whole rows of the screen
+    _hardware = (x == 0 && w == lcd->getWidth() && lcd->setScrollArea(y, _lines * _lineHeight));
+
+    _drawn.assign(_lines, 0);
+    if (!_hardware) _text.assign(_lines * (CONSOLE_COLUMNS + 1), 0);
+    clear();
+}
+
+TextConsole::~TextConsole()
+{
+    if (_hardware) _lcd->resetScroll();
+}
+
+/** Add text at the bottom, a line per '\n' separated part. */
+void TextConsole::println(const char* text)
+{
+    FrameBuffer* fb = _lcd->getFrameBuffer();
+    int x0, y0, x1, y1;
+    _lcd->getClip(x0, y0, x1, y1);
+
+    _lcd->setFrameBuffer(NULL);
+    _lcd->setClip(_x, _y, _x + _w - 1, _y + _lines * _lineHeight - 1);
+    _lcd->foreground(_foreground);
+    _lcd->background(_background);
+    _lcd->setTransparent(false);
+
+    _lcd->beginBatch();
+    while (true) {
+        const char* end = strchr(text, '\n');
+        if (!end) {
+            addLine(text, strlen(text));
+            break;
+        }
+        addLine(text, end - text);
+        text = end + 1;
+    }
+    _lcd->endBatch();
+
+    _lcd->setClip(x0, y0, x1, y1);
+    _lcd->setFrameBuffer(fb);
+}
+
+/** Empty the console. */
+void TextConsole::clear()
+{
+    FrameBuffer* fb = _lcd->getFrameBuffer();
+    _lcd->setFrameBuffer(NULL);
+    _lcd->beginBatch();
+    _lcd->fillRect(_x, _y, _x + _w - 1, _y + _lines * _lineHeight - 1, _background);
+    if (_hardware) _lcd->scrollTo(0);
+    _lcd->endBatch();
+    _lcd->setFrameBuffer(fb);
+
+    _count = 0;
+    _first = 0;
+    for (int i = 0; i < _lines; i++) _drawn[i] = 0;
+}
+
+bool TextConsole::isHardware()
+{
+    return _hardware;
+}
+
+// One line, cut to what fits. Slots are the line positions in drawing
+// order; with hardware scrolling the top line's slot moves down a line at
+// a time, without it the slots keep the text and rows are redrawn.
+void TextConsole::addLine(const char* text, int length)
+{
+    char line[CONSOLE_COLUMNS + 1];
+    int n = 0, width = 0;
+    while (n < length && n < CONSOLE_COLUMNS && width + _lcd->charWidth(text[n]) <= _w) {
+        width += _lcd->charWidth(text[n]);
+        line[n] = text[n];
+        n++;
+    }
+    line[n] = 0;
+
+    int slot = (_first + _count) % _lines;
+    bool scroll = (_count == _lines);
+    if (scroll) {
+        _first = (_first + 1) % _lines;
+    } else {
+        _count++;
+    }
+
+    if (_hardware) {
+        // the oldest line's rows come back at the bottom
+        _lcd->scrollTo(_first * _lineHeight);
+        drawRow(slot, line);
+        return;
+    }
+
+    memcpy(&_text[slot * (CONSOLE_COLUMNS + 1)], line, n + 1);
+    if (!scroll) {
+        drawRow(_count - 1, line);
+        return;
+    }
+    for (int row = 0; row < _lines; row++) {
+        drawRow(row, &_text[((_first + row) % _lines) * (CONSOLE_COLUMNS + 1)]);
+    }
+}
+
+// text at screen row position row, then what is left of the old text there
+void TextConsole::drawRow(int row, const char* text)
+{
+    int top = _y + row * _lineHeight;
+    int width = 0;
+    for (const char* c = text; *c; c++) width += _lcd->charWidth(*c);
+
+    _lcd->locate(_x, top);
+    _lcd->drawString(text);
+    if (_drawn[row] > width) {
+        _lcd->fillRect(_x + width, top, _x + _drawn[row] - 1, top + _lineHeight - 1, _background);
+    }
+    _drawn[row] = width;
+}
@@ -0,0 +1,68 @@
+/* Scrolling text console for the ILI9341_Mbed library.
+ * for mbed os 6.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef TEXTCONSOLE_H
+#define TEXTCONSOLE_H
+
+#include "mbed.h"
+#include "ILI9341_Mbed.h"
+#include <vector>
+
+#define CONSOLE_COLUMNS 80      // characters kept per line for redrawing
+
+/** Log window: lines of text added at the bottom, the oldest scrolling out
+ * at the top.
+ *
+ * When the area spans the screen width in orientation 0 or 2, the panel's
+ * vertical scrolling moves the lines: a new line costs one scroll command
+ * and the line itself. Otherwise (orientations 1 and 3 scroll columns, not
+ * rows) the console keeps the text of its lines and redraws them all; a
+ * line only clears the part of the old one its text does not cover.
+ *
+ * Lines are cut at the area's right edge. They are drawn with the driver's
+ * font, its height at construction is the line height, and opaque in the
+ * console's colours, which stay set on the driver. The console draws
+ * straight to the panel, bypassing an attached frame buffer; other drawing
+ * must stay out of its area while it scrolls.
+ */
+class TextConsole
+{
+    private:
+        ILI9341_Mbed* _lcd;
+        int _x, _y, _w;
+        int _lineHeight;
+        int _lines;
+        int _foreground;
+        int _background;
+        bool _hardware;
+
+        int _count;                 // lines written, up to _lines
+        int _first;                 // slot of the top line
+        std::vector<uint16_t> _drawn;   // text width drawn per slot
+        std::vector<char> _text;        // fallback: text per slot
+
+    public:
+        TextConsole(ILI9341_Mbed* lcd, int x, int y, int w, int h, int foreground = White, int background = Black);
+        ~TextConsole();
+
+        void println(const char* text);
+        void clear();
+
+        bool isHardware();
+
+    private:
+        void addLine(const char* text, int length);
+        void drawRow(int row, const char* text);
+};
+
+#endif
@@ -0,0 +1,42 @@
+/* RGB565 bitmaps in flash, as written by tools/img2bitmap.py.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef BITMAP565_H
+#define BITMAP565_H
+
+#include <stdint.h>
+
+#define BITMAP_RAW 0            // width * height pixels, row by row
+#define BITMAP_RLE 1            // runs, see below
+
+#define BITMAP_LITERAL 0x8000   // run header: copy the next n words
+#define BITMAP_COUNT 0x7FFF     // run header: pixel count, 1..32767
+
+/** Image in native RGB565. BITMAP_RLE data is a list of runs that never
+ * cross a row end: a header word with BITMAP_LITERAL set is followed by
+ * that many pixels, one without it by the single colour it repeats.
+ *
+ * Keyed bitmaps are transparent where their pixels equal key; the
+ * converter picks a key no opaque pixel uses and, in RLE data, always
+ * stores transparent pixels as repeat runs.
+ */
+struct Bitmap565
+{
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;         // BITMAP_RAW or BITMAP_RLE
+    uint8_t keyed;
+    uint16_t key;
+    const uint16_t* data;
+};
+
+#endif
@@ -5,7 +5,7 @@
 
 /** Arial Font with 12*12 matrix to use with SPI_TFT lib
  */ 
-const unsigned char Arial12x12[] = {
+constexpr unsigned char Arial12x12[] = {
         25,12,12,2,                                                                           // Length,horz,vert,byte/vert
         0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Code for char  
         0x02, 0x00, 0x00, 0x7F, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Code for char !
@@ -104,3 +104,8 @@ const unsigned char Arial12x12[] = {
         0x07, 0x00, 0x00, 0x20, 0x00, 0x10, 0x00, 0x10, 0x00, 0x20, 0x00, 0x20, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Code for char ~
         0x08, 0x00, 0x00, 0xFE, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0xFE, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00   // Code for char 
         };
+
+#include "PackedFont.h"
+
+/** Arial12x12 re-laid out row-major with trimmed glyphs, for ILI9341_Mbed::set_font() */
+constexpr auto Arial12x12Packed = PACK_FONT(Arial12x12);
@@ -7,7 +7,7 @@
 
 /** Arial Font italic with 27*28 pixel matrix for use with SPI_TFT lib
 */
-const unsigned char Arial28x28[] = {
+constexpr unsigned char Arial28x28[] = {
 113,28,28,4,
 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
@@ -491,3 +491,7 @@ const unsigned char Arial28x28[] = {
 
 };
 
+#include "PackedFont.h"
+
+/** Arial28x28 re-laid out row-major with trimmed glyphs, for ILI9341_Mbed::set_font() */
+constexpr auto Arial28x28Packed = PACK_FONT(Arial28x28);
@@ -0,0 +1,122 @@
+/* Compile-time re-layout of the GLCD fonts into row-major packed glyphs.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef PACKEDFONT_H
+#define PACKEDFONT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PACKED_FIRST 32         // first character of the fonts
+#define PACKED_GLYPHS 96        // characters 32..127
+
+/** Ink box of one character and where its rows are in the bitmap. */
+struct PackedGlyph
+{
+    uint16_t offset;        // first byte in PackedFont::bitmap
+    uint8_t advance;        // pen advance in pixels
+    uint8_t left;           // ink box inside the character cell
+    uint8_t top;
+    uint8_t width;
+    uint8_t rows;
+};
+
+/** Font with the glyphs trimmed to their ink box and stored row by row,
+ * (width + 7) / 8 bytes per row, most significant bit leftmost. A row of
+ * a glyph expands with one byte load per 8 pixels.
+ */
+template <size_t Bytes>
+struct PackedFont
+{
+    uint8_t height;
+    PackedGlyph glyphs[PACKED_GLYPHS];
+    uint8_t bitmap[Bytes];
+};
+
+// GLCD layout: length, horizontal size, vertical size, bytes per column,
+// then per character its width followed by the columns, top bit first
+constexpr int glcdAdvance(const unsigned char* font, int c)
+{
+    int w = font[4 + c * font[0]];
+    return (w + 2 < font[1]) ? w + 2 : font[1];
+}
+
+constexpr bool glcdPixel(const unsigned char* font, int c, int x, int y)
+{
+    return (font[4 + c * font[0] + font[3] * x + (y >> 3) + 1] >> (y & 7)) & 1;
+}
+
+// ink box of a character inside its advance, all zero when it is empty
+constexpr PackedGlyph glcdBox(const unsigned char* font, int c)
+{
+    int x0 = 255, y0 = 255, x1 = -1, y1 = -1;
+    for (int x = 0; x < glcdAdvance(font, c); x++) {
+        for (int y = 0; y < font[2]; y++) {
+            if (!glcdPixel(font, c, x, y)) continue;
+            if (x < x0) x0 = x;
+            if (y < y0) y0 = y;
+            if (x > x1) x1 = x;
+            if (y > y1) y1 = y;
+        }
+    }
+
+    PackedGlyph g = { 0, (uint8_t)glcdAdvance(font, c), 0, 0, 0, 0 };
+    if (x1 >= 0) {
+        g.left = x0;
+        g.top = y0;
+        g.width = x1 - x0 + 1;
+        g.rows = y1 - y0 + 1;
+    }
+    return g;
+}
+
+/** Bitmap bytes the packed copy of a GLCD font needs. */
+constexpr size_t packedFontBytes(const unsigned char* font)
+{
+    size_t bytes = 0;
+    for (int c = 0; c < PACKED_GLYPHS; c++) {
+        PackedGlyph g = glcdBox(font, c);
+        bytes += g.rows * ((g.width + 7) / 8);
+    }
+    return bytes ? bytes : 1;
+}
+
+/** Packed copy of a GLCD font, evaluated by the compiler. Only the result
+ * ends up in flash when the source array is not used at run time.
+ */
+template <size_t Bytes>
+constexpr PackedFont<Bytes> packFont(const unsigned char* font)
+{
+    PackedFont<Bytes> packed {};
+    size_t offset = 0;
+
+    packed.height = font[2];
+    for (int c = 0; c < PACKED_GLYPHS; c++) {
+        PackedGlyph g = glcdBox(font, c);
+        g.offset = offset;
+        packed.glyphs[c] = g;
+
+        for (int y = 0; y < g.rows; y++) {
+            for (int x = 0; x < g.width; x++) {
+                if (glcdPixel(font, c, g.left + x, g.top + y)) {
+                    packed.bitmap[offset + x / 8] |= 0x80 >> (x & 7);
+                }
+            }
+            offset += (g.width + 7) / 8;
+        }
+    }
+    return packed;
+}
+
+#define PACK_FONT(font) packFont<packedFontBytes(font)>(font)
+
+#endif
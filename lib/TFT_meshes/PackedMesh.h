@@ -0,0 +1,89 @@
+/* Quantized triangle meshes in flash, as written by tools/obj2mesh.py.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef PACKEDMESH_H
+#define PACKEDMESH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MESH_INDEX16 0x01       // uint16_t indices, else uint8_t
+#define MESH_NORMALS 0x02       // a packed normal per triangle
+#define MESH_EDGE_FACES 0x04    // the two triangles of every edge
+
+#define MESH_NORMAL_ONE 127     // packed normal component of length 1
+
+/** Indexed mesh read in place from const data, nothing is copied to RAM.
+ *
+ * Positions are int16_t x, y, z per vertex: position = offset + q * scale,
+ * per axis, so every mesh uses the full 16 bits of its bounding box.
+ * Triangles are three vertex indices, edges two, each unique edge once for
+ * wireframes. Indices are uint8_t for up to 256 vertices, else uint16_t
+ * (MESH_INDEX16). Normals are int8_t x, y, z per triangle, unit length at
+ * MESH_NORMAL_ONE, pointing the way (v1 - v0) x (v2 - v0) does. Edge faces
+ * are two uint16_t triangle indices per edge, the same one twice for an
+ * edge of one triangle and the first two for an edge of more, so a
+ * wireframe can leave out the edges of faces turned away; without them it
+ * is drawn see-through. The bounding sphere is in the same units as the
+ * positions.
+ */
+struct PackedMesh
+{
+    uint16_t vertexCount;
+    uint16_t triangleCount;
+    uint16_t edgeCount;
+    uint8_t flags;          // MESH_INDEX16, MESH_NORMALS, MESH_EDGE_FACES
+    uint8_t spare;
+    float scale[3];
+    float offset[3];
+    float center[3];        // bounding sphere
+    float radius;
+    const int16_t* positions;
+    const void* triangles;
+    const void* edges;
+    const int8_t* normals;  // NULL without MESH_NORMALS
+    const uint16_t* edgeFaces;  // NULL without MESH_EDGE_FACES
+};
+
+inline int meshIndex(const PackedMesh& m, const void* list, int i)
+{
+    if (m.flags & MESH_INDEX16) return ((const uint16_t*)list)[i];
+    return ((const uint8_t*)list)[i];
+}
+
+/** Vertex corner (0..2) of triangle t. */
+inline int meshTriangle(const PackedMesh& m, int t, int corner)
+{
+    return meshIndex(m, m.triangles, t * 3 + corner);
+}
+
+/** End (0 or 1) of edge e. */
+inline int meshEdge(const PackedMesh& m, int e, int end)
+{
+    return meshIndex(m, m.edges, e * 2 + end);
+}
+
+/** Triangle on side (0 or 1) of edge e, needs MESH_EDGE_FACES. */
+inline int meshEdgeFace(const PackedMesh& m, int e, int side)
+{
+    return m.edgeFaces[e * 2 + side];
+}
+
+inline void meshVertex(const PackedMesh& m, int v, float& x, float& y, float& z)
+{
+    const int16_t* q = m.positions + v * 3;
+    x = m.offset[0] + q[0] * m.scale[0];
+    y = m.offset[1] + q[1] * m.scale[1];
+    z = m.offset[2] + q[2] * m.scale[2];
+}
+
+#endif
@@ -0,0 +1,45 @@
+// cube, 8 vertices, 12 triangles, 18 edges, 228 bytes, generated by tools/obj2mesh.py from cube.obj
+
+#ifndef CUBE_H
+#define CUBE_H
+
+#include "PackedMesh.h"
+
+static const int16_t cube_positions[] = {
+    -32767, -32767, -32767, -32767, 32767, -32767, 32767, 32767, -32767, 32767, -32767, -32767,
+    32767, 32767, 32767, 32767, -32767, 32767, -32767, 32767, 32767, -32767, -32767, 32767,
+};
+
+static const uint8_t cube_triangles[] = {
+    0, 1, 2, 0, 2, 3, 3, 2, 4, 3, 4, 5,
+    5, 4, 6, 5, 6, 7, 7, 6, 1, 7, 1, 0,
+    1, 6, 4, 1, 4, 2, 5, 7, 0, 5, 0, 3,
+};
+
+static const uint8_t cube_edges[] = {
+    0, 1, 0, 2, 0, 3, 0, 5, 0, 7, 1, 2,
+    1, 4, 1, 6, 1, 7, 2, 3, 2, 4, 3, 4,
+    3, 5, 4, 5, 4, 6, 5, 6, 5, 7, 6, 7,
+};
+
+static const int8_t cube_normals[] = {
+    0, 0, -127, 0, 0, -127, 127, 0, 0, 127, 0, 0,
+    0, 0, 127, 0, 0, 127, -127, 0, 0, -127, 0, 0,
+    0, 127, 0, 0, 127, 0, 0, -127, 0, 0, -127, 0,
+};
+
+static const uint16_t cube_edge_faces[] = {
+    0, 7, 0, 1, 1, 11, 10, 11, 7, 10, 0, 9,
+    8, 9, 6, 8, 6, 7, 1, 2, 2, 9, 2, 3,
+    3, 11, 3, 4, 4, 8, 4, 5, 5, 10, 5, 6,
+};
+
+const PackedMesh cube = {
+    8, 12, 18, MESH_NORMALS | MESH_EDGE_FACES, 0,
+    { 1.5259254723787308e-05f, 1.5259254723787308e-05f, 1.5259254723787308e-05f },
+    { 0.5f, 0.5f, 0.5f },
+    { 0.5f, 0.5f, 0.5f }, 0.866113007068634f,
+    cube_positions, cube_triangles, cube_edges, cube_normals, cube_edge_faces
+};
+
+#endif
@@ -10,10 +10,50 @@
  * THE SOFTWARE.
  */
 
+// the depth buffer only makes sense for filled faces
+#if defined(RENDER_ZBUFFER) && !defined(RENDER_SOLID)
+#define RENDER_SOLID
+#endif
+
+#if defined(RENDER_OVERLAY) && !defined(RENDER_PROFILE)
+#error "RENDER_OVERLAY shows the RENDER_PROFILE timings"
+#endif
+
+#if defined(RENDER_BANDS) && (defined(RENDER_ZBUFFER) || defined(RENDER_FRAMEBUFFER) || defined(RENDER_ASYNC))
+#error "RENDER_BANDS renders without a frame or depth buffer"
+#endif
+
+// a 320x240 RGB565 frame is 150 KB, the STM32F407 has 128 KB of main SRAM
+#if defined(RENDER_FRAMEBUFFER) && defined(TARGET_STM32F407xG)
+#error "RENDER_FRAMEBUFFER needs 150 KB of RAM for the frame, more than the STM32F407 has: use RENDER_BANDS"
+#endif
+
+#if defined(RENDER_ASYNC) && defined(TARGET_STM32F407xG)
+#error "RENDER_ASYNC needs two 150 KB frames, more than the STM32F407 has: use RENDER_BANDS"
+#endif
+
+#if defined(RENDER_ANTIALIAS) && !(defined(RENDER_FRAMEBUFFER) || defined(RENDER_ASYNC) || defined(RENDER_BANDS))
+#error "RENDER_ANTIALIAS blends into a RAM target: RENDER_FRAMEBUFFER, RENDER_ASYNC or RENDER_BANDS"
+#endif
+
+#if defined(RENDER_DISPLAYLIST) && (defined(RENDER_BANDS) || defined(RENDER_ZBUFFER))
+#error "RENDER_DISPLAYLIST records lines and triangles, not RENDER_BANDS or RENDER_ZBUFFER faces"
+#endif
+
+#if defined(RENDER_PIPELINE) && (defined(RENDER_PROFILE) || defined(RENDER_DISPLAYLIST))
+#error "RENDER_PIPELINE splits the frame over two threads, RENDER_PROFILE and RENDER_DISPLAYLIST follow one"
+#endif
+
 #include <mbed.h>
 #include <ILI9341_Mbed.h>
+#include <BandRenderer.h>
+#include <DisplayList.h>
+#include <RenderQueue.h>
+#include <Benchmark.h>
 #include <Arial12x12.h>
-#include <vector>
+#include <cube.h>
+#include <algorithm>
+#include <atomic>
 
 SPI spi(SPI_MOSI, SPI_MISO, SPI_SCK);
 
@@ -22,10 +62,25 @@ DigitalOut LCD_CS(SPI_CS);
 DigitalOut LCD_RESET(PE_2);
 DigitalOut LCD_DC(PE_4);
 
-unsigned char *font12x12 = (unsigned char *)Arial12x12;
-
 ILI9341_Mbed lcd(&spi, &LCD_CS, &LCD_RESET, &LCD_DC);
 
+#define STATS_FRAMES 100  // frames per statistics printout
+#define NEAR_PLANE 0.1f   // view space z of the near clipping plane
+#define GEOMETRY_STACK 4096  // bytes, RENDER_PIPELINE geometry thread
+
+// Static work space of OnUpdate(), a bigger mesh is refused at start-up
+#ifndef MAX_MESH_VERTICES
+#define MAX_MESH_VERTICES 64
+#endif
+#ifndef MAX_MESH_TRIANGLES
+#define MAX_MESH_TRIANGLES 128
+#endif
+// the near plane adds at most two corners to a triangle and splits it in two
+#define MAX_VIEW_VERTICES (MAX_MESH_VERTICES + 2 * MAX_MESH_TRIANGLES)
+#define MAX_FRAME_FACES (2 * MAX_MESH_TRIANGLES)
+// lines or triangles a frame submits: at most an edge per triangle side
+#define MAX_FRAME_PRIMITIVES (3 * MAX_MESH_TRIANGLES)
+
 template <class t>
 struct vec3d
 {
@@ -61,14 +116,12 @@ struct vec3d
     }
 };
 
-struct triangle
+// Triangle queued for rasterization
+struct face
 {
-    vec3d<float> p[3];
-};
-
-struct mesh
-{
-    std::vector<triangle> tris;
+    int v[3];
+    int color;
+    float depth;    // average view space z
 };
 
 struct mat4x4
@@ -76,40 +129,98 @@ struct mat4x4
     float m[4][4] = {0};
 };
 
-mesh meshCube;
-mat4x4 matProj;
-bool CreateCubeMesh(int screenWidth, int screenHeight)
+// View space plane, points with a*x + b*y + c*z + d >= 0 are inside
+struct plane
 {
-    meshCube.tris = {
-
-        // SOUTH
-        {0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f},
-        {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f},
-
-        // EAST
-        {1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f},
-        {1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f},
-
-        // NORTH
-        {1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f},
-        {1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+    float a, b, c, d;
+};
 
-        // WEST
-        {0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f},
-        {0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+// Work the culling stage saved, counted over every OnUpdate() call; with
+// RENDER_PIPELINE the geometry thread counts while the main thread prints
+struct CullStats
+{
+    std::atomic<uint32_t> objects;
+    std::atomic<uint32_t> objectsCulled;     // bounding sphere outside the frustum
+    std::atomic<uint32_t> faces;
+    std::atomic<uint32_t> facesCulled;       // facing away from the camera
+};
 
-        // TOP
-        {0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f},
-        {0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f},
+const PackedMesh &meshCube = cube;  // read in place from flash
+mat4x4 matProj;
+plane frustum[6];
+CullStats cullStats;
+
+#ifdef RENDER_ZBUFFER
+DepthBuffer* depthBuffer;
+#endif
+
+#ifdef RENDER_BANDS
+BandRenderer* bandRenderer;
+#endif
+
+#ifdef RENDER_DISPLAYLIST
+DisplayList* displayList;
+#endif
+
+#ifdef RENDER_PIPELINE
+// geometry thread -> raster thread, and what the raster thread drew of
+// the current frame for the erase pass
+RenderQueue renderQueue;
+RenderPrimitive pipelineFrame[MAX_FRAME_PRIMITIVES];
+int pipelineFrameCount;
+#endif
+
+// Frustum planes of a projection matrix (Gribb and Hartmann): with row
+// vectors clip = v * m, each plane is a sum or difference of columns
+void BuildFrustum(mat4x4 &m, plane planes[6])
+{
+    static const int column[6] = { 0, 0, 1, 1, 2, 2 };
+    static const float sign[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
 
-        // BOTTOM
-        {1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
-        {1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f},
+    for (int i = 0; i < 6; i++)
+    {
+        int c = column[i];
+        plane &p = planes[i];
+        if (i == 4)
+        {
+            // near: z in clip space runs from 0, not -w
+            p.a = m.m[0][2];
+            p.b = m.m[1][2];
+            p.c = m.m[2][2];
+            p.d = m.m[3][2];
+        }
+        else
+        {
+            p.a = m.m[0][3] + sign[i] * m.m[0][c];
+            p.b = m.m[1][3] + sign[i] * m.m[1][c];
+            p.c = m.m[2][3] + sign[i] * m.m[2][c];
+            p.d = m.m[3][3] + sign[i] * m.m[3][c];
+        }
+
+        float l = sqrtf(p.a * p.a + p.b * p.b + p.c * p.c);
+        p.a /= l;
+        p.b /= l;
+        p.c /= l;
+        p.d /= l;
+    }
+}
 
-    };
+// False when a view space sphere is entirely outside one of the planes
+bool SphereInFrustum(const vec3d<float> &center, float radius, const plane planes[6])
+{
+    for (int i = 0; i < 6; i++)
+    {
+        const plane &p = planes[i];
+        if (p.a * center.x + p.b * center.y + p.c * center.z + p.d < -radius)
+            return false;
+    }
+    return true;
+}
 
+bool CreateProjection(int screenWidth, int screenHeight)
+{
     // Projection Matrix
-    float fNear = 0.1f;
+    float fNear = NEAR_PLANE;
     float fFar = 1000.0f;
     float fFov = 90.0f;
     float fAspectRatio = (float)screenHeight / (float)screenWidth;
@@ -121,6 +232,7 @@ bool CreateCubeMesh(int screenWidth, int screenHeight)
     matProj.m[3][2] = (-fFar * fNear) / (fFar - fNear);
     matProj.m[2][3] = 1.0f;
     matProj.m[3][3] = 0.0f;
+    BuildFrustum(matProj, frustum);
 
     return true;
 }
@@ -140,8 +252,139 @@ void MultiplyMatrixVector(vec3d<float> &i, vec3d<float> &o, mat4x4 &m)
     }
 }
 
+// View space vertex to screen pixels
+void ProjectVertex(vec3d<float> &view, vec3d<float> &screen, int screenWidth, int screenHeight)
+{
+    MultiplyMatrixVector(view, screen, matProj);
+    screen.x = (screen.x + 1.0f) * 0.5f * (float)screenWidth;
+    screen.y = (screen.y + 1.0f) * 0.5f * (float)screenHeight;
+}
+
+// Point where the view space segment a-b crosses the near plane
+vec3d<float> ClipNear(const vec3d<float> &a, const vec3d<float> &b)
+{
+    float t = (NEAR_PLANE - a.z) / (b.z - a.z);
+    vec3d<float> p;
+    p.x = a.x + (b.x - a.x) * t;
+    p.y = a.y + (b.y - a.y) * t;
+    p.z = NEAR_PLANE;
+    return p;
+}
+
+// Scale an RGB565 colour by a light intensity
+int ShadeColor(int color, float lum)
+{
+    if (lum < 0.15f) lum = 0.15f; // ambient
+    if (lum > 1.0f) lum = 1.0f;
+
+    int r = (int)(((color >> 11) & 0x1F) * lum);
+    int g = (int)(((color >> 5) & 0x3F) * lum);
+    int b = (int)((color & 0x1F) * lum);
+    return (r << 11) | (g << 5) | b;
+}
+
+// Projected z (0 at the near plane, 1 at the far plane) to a depth buffer value
+int DepthValue(float z)
+{
+    if (z < 0.0f) return 0;
+    if (z > 1.0f) return DEPTH_FAR;
+    return (int)(z * DEPTH_FAR);
+}
+
+// Normal of triangle t: the mesh's own, rotated like the vertices, or from
+// the view space corners; only the mesh's own has length 1
+vec3d<float> FaceNormal(int t, vec3d<float> &p0, vec3d<float> &p1, vec3d<float> &p2, mat4x4 &matRotZ, mat4x4 &matRotX)
+{
+    vec3d<float> normal;
+    if (meshCube.flags & MESH_NORMALS)
+    {
+        const int8_t *packed = meshCube.normals + t * 3;
+        vec3d<float> n = { packed[0] * (1.0f / MESH_NORMAL_ONE), packed[1] * (1.0f / MESH_NORMAL_ONE),
+                           packed[2] * (1.0f / MESH_NORMAL_ONE) };
+        vec3d<float> nZ;
+        MultiplyMatrixVector(n, nZ, matRotZ);
+        MultiplyMatrixVector(nZ, normal, matRotX);
+    }
+    else
+    {
+        vec3d<float> line1, line2;
+        line1.x = p1.x - p0.x;
+        line1.y = p1.y - p0.y;
+        line1.z = p1.z - p0.z;
+
+        line2.x = p2.x - p0.x;
+        line2.y = p2.y - p0.y;
+        line2.z = p2.z - p0.z;
+
+        normal.x = line1.y * line2.z - line1.z * line2.y;
+        normal.y = line1.z * line2.x - line1.x * line2.z;
+        normal.z = line1.x * line2.y - line1.y * line2.x;
+    }
+    return normal;
+}
+
+// A face whose normal points away from the camera at p0 is hidden, the sign
+// does not need the normal's length
+bool BackFacing(vec3d<float> &normal, vec3d<float> &p0)
+{
+    return normal.x * p0.x + normal.y * p0.y + normal.z * p0.z >= 0.0f;
+}
+
+// Screen space primitives, drawn the way the build options ask for
+void DrawLine(int x0, int y0, int x1, int y1, int color)
+{
+#if defined(RENDER_BANDS) && defined(RENDER_ANTIALIAS)
+    bandRenderer->lineAA(x0, y0, x1, y1, color);
+#elif defined(RENDER_BANDS)
+    bandRenderer->line(x0, y0, x1, y1, color);
+#elif defined(RENDER_DISPLAYLIST) && defined(RENDER_ANTIALIAS)
+    displayList->lineAA(x0, y0, x1, y1, color);
+#elif defined(RENDER_DISPLAYLIST)
+    displayList->line(x0, y0, x1, y1, color);
+#elif defined(RENDER_ANTIALIAS)
+    lcd.lineAA(x0, y0, x1, y1, color);
+#else
+    lcd.line(x0, y0, x1, y1, color);
+#endif
+}
+
+// Corners in sub-pixels, z only used with the depth buffer
+void DrawTriangle(int x0, int y0, int z0, int x1, int y1, int z1, int x2, int y2, int z2, int color)
+{
+#if defined(RENDER_ZBUFFER)
+    lcd.fillTriangleDepth(x0, y0, z0, x1, y1, z1, x2, y2, z2, color, depthBuffer);
+#elif defined(RENDER_BANDS)
+    bandRenderer->fillTriangleSub(x0, y0, x1, y1, x2, y2, color);
+#elif defined(RENDER_DISPLAYLIST)
+    displayList->fillTriangleSub(x0, y0, x1, y1, x2, y2, color);
+#else
+    lcd.fillTriangleSub(x0, y0, x1, y1, x2, y2, color);
+#endif
+}
+
+// OnUpdate() output: drawn here, or queued for the raster thread
+void SubmitLine(int x0, int y0, int x1, int y1, int color)
+{
+#ifdef RENDER_PIPELINE
+    renderQueue.pushLine(x0, y0, x1, y1, color);
+#else
+    DrawLine(x0, y0, x1, y1, color);
+#endif
+}
+
+void SubmitTriangle(int x0, int y0, int z0, int x1, int y1, int z1, int x2, int y2, int z2, int color)
+{
+#ifdef RENDER_PIPELINE
+    renderQueue.pushTriangle(x0, y0, z0, x1, y1, z1, x2, y2, z2, color);
+#else
+    DrawTriangle(x0, y0, z0, x1, y1, z1, x2, y2, z2, color);
+#endif
+}
+
 bool OnUpdate(float fTheta, int screenWidth, int screenHeight, int color)
 {
+    PROFILE_BEGIN(PROFILE_SETUP);
+
     // Set up rotation matrices
     mat4x4 matRotZ, matRotX;
 
@@ -161,55 +404,264 @@ bool OnUpdate(float fTheta, int screenWidth, int screenHeight, int color)
     matRotX.m[2][2] = cosf(fTheta * 0.5f);
     matRotX.m[3][3] = 1;
 
-    // Draw Triangles
-    for (auto tri : meshCube.tris)
+    PROFILE_END(PROFILE_SETUP);
+    PROFILE_BEGIN(PROFILE_TRANSFORM);
+
+    // Whole object culling: only the bounding sphere centre is transformed
+    // when the object is off screen
+    vec3d<float> center = { meshCube.center[0], meshCube.center[1], meshCube.center[2] };
+    vec3d<float> centerZ, centerZX;
+    MultiplyMatrixVector(center, centerZ, matRotZ);
+    MultiplyMatrixVector(centerZ, centerZX, matRotX);
+    centerZX.z += 3.0f;
+
+    cullStats.objects++;
+    if (!SphereInFrustum(centerZX, meshCube.radius, frustum))
     {
-        triangle triProjected, triTranslated, triRotatedZ, triRotatedZX;
+        cullStats.objectsCulled++;
+        PROFILE_END(PROFILE_TRANSFORM);
+        return true;
+    }
+
+    // Transform every vertex once, near plane corners go after the mesh's
+    static vec3d<float> viewVerts[MAX_VIEW_VERTICES], screenVerts[MAX_VIEW_VERTICES];
+
+    for (int i = 0; i < meshCube.vertexCount; i++)
+    {
+        vec3d<float> vert, vertRotatedZ, vertRotatedZX;
+        meshVertex(meshCube, i, vert.x, vert.y, vert.z);
 
         // Rotate in Z-Axis
-        MultiplyMatrixVector(tri.p[0], triRotatedZ.p[0], matRotZ);
-        MultiplyMatrixVector(tri.p[1], triRotatedZ.p[1], matRotZ);
-        MultiplyMatrixVector(tri.p[2], triRotatedZ.p[2], matRotZ);
+        MultiplyMatrixVector(vert, vertRotatedZ, matRotZ);
 
         // Rotate in X-Axis
-        MultiplyMatrixVector(triRotatedZ.p[0], triRotatedZX.p[0], matRotX);
-        MultiplyMatrixVector(triRotatedZ.p[1], triRotatedZX.p[1], matRotX);
-        MultiplyMatrixVector(triRotatedZ.p[2], triRotatedZX.p[2], matRotX);
+        MultiplyMatrixVector(vertRotatedZ, vertRotatedZX, matRotX);
 
         // Offset into the screen
-        triTranslated = triRotatedZX;
-        triTranslated.p[0].z = triRotatedZX.p[0].z + 3.0f;
-        triTranslated.p[1].z = triRotatedZX.p[1].z + 3.0f;
-        triTranslated.p[2].z = triRotatedZX.p[2].z + 3.0f;
-
-        // Project triangles from 3D --> 2D
-        MultiplyMatrixVector(triTranslated.p[0], triProjected.p[0], matProj);
-        MultiplyMatrixVector(triTranslated.p[1], triProjected.p[1], matProj);
-        MultiplyMatrixVector(triTranslated.p[2], triProjected.p[2], matProj);
-
-        // Scale into view
-        triProjected.p[0].x += 1.0f;
-        triProjected.p[0].y += 1.0f;
-        triProjected.p[1].x += 1.0f;
-        triProjected.p[1].y += 1.0f;
-        triProjected.p[2].x += 1.0f;
-        triProjected.p[2].y += 1.0f;
-        triProjected.p[0].x *= 0.5f * (float)screenWidth;
-        triProjected.p[0].y *= 0.5f * (float)screenHeight;
-        triProjected.p[1].x *= 0.5f * (float)screenWidth;
-        triProjected.p[1].y *= 0.5f * (float)screenHeight;
-        triProjected.p[2].x *= 0.5f * (float)screenWidth;
-        triProjected.p[2].y *= 0.5f * (float)screenHeight;
-
-        // Rasterize triangle
-        lcd.line(triProjected.p[0].x, triProjected.p[0].y, triProjected.p[1].x, triProjected.p[1].y, color);
-        lcd.line(triProjected.p[1].x, triProjected.p[1].y, triProjected.p[2].x, triProjected.p[2].y, color);
-        lcd.line(triProjected.p[2].x, triProjected.p[2].y, triProjected.p[0].x, triProjected.p[0].y, color);
+        vertRotatedZX.z += 3.0f;
+        viewVerts[i] = vertRotatedZX;
+
+        // Project from 3D --> 2D and scale into view
+        ProjectVertex(vertRotatedZX, screenVerts[i], screenWidth, screenHeight);
+    }
+
+    PROFILE_END(PROFILE_TRANSFORM);
+    PROFILE_BEGIN(PROFILE_RASTER);
+
+#ifdef RENDER_SOLID
+    // Faces to draw this frame
+    static face facesToRaster[MAX_FRAME_FACES];
+    int faceCount = 0;
+    int vertCount = meshCube.vertexCount;
+
+    for (int t = 0; t < meshCube.triangleCount; t++)
+    {
+        face f;
+        f.v[0] = meshTriangle(meshCube, t, 0);
+        f.v[1] = meshTriangle(meshCube, t, 1);
+        f.v[2] = meshTriangle(meshCube, t, 2);
+        vec3d<float> &p0 = viewVerts[f.v[0]];
+        vec3d<float> &p1 = viewVerts[f.v[1]];
+        vec3d<float> &p2 = viewVerts[f.v[2]];
+
+        // Only faces pointing at the camera are filled
+        vec3d<float> normal = FaceNormal(t, p0, p1, p2, matRotZ, matRotX);
+        cullStats.faces++;
+        if (BackFacing(normal, p0))
+        {
+            cullStats.facesCulled++;
+            continue;
+        }
+
+        if (!(meshCube.flags & MESH_NORMALS))
+        {
+            float l = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+            normal.x /= l;
+            normal.y /= l;
+            normal.z /= l;
+        }
+
+        // Flat shading, light comes from the camera
+        f.color = ShadeColor(color, -normal.z);
+        f.depth = (p0.z + p1.z + p2.z) / 3.0f;
+
+        int behind = (p0.z < NEAR_PLANE) + (p1.z < NEAR_PLANE) + (p2.z < NEAR_PLANE);
+        if (behind == 0)
+        {
+            facesToRaster[faceCount++] = f;
+            continue;
+        }
+        if (behind == 3)
+            continue;
+
+        // Cut at the near plane (Sutherland-Hodgman against one plane): the
+        // part in front is a triangle or a quad, its new corners are added
+        // after the mesh vertices
+        int poly[4];
+        int corners = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            int a = f.v[i], b = f.v[(i + 1) % 3];
+            vec3d<float> va = viewVerts[a], vb = viewVerts[b];
+            if (va.z >= NEAR_PLANE)
+                poly[corners++] = a;
+            if ((va.z >= NEAR_PLANE) != (vb.z >= NEAR_PLANE))
+            {
+                viewVerts[vertCount] = ClipNear(va, vb);
+                ProjectVertex(viewVerts[vertCount], screenVerts[vertCount], screenWidth, screenHeight);
+                poly[corners++] = vertCount++;
+            }
+        }
+
+        for (int i = 2; i < corners; i++)
+        {
+            f.v[0] = poly[0];
+            f.v[1] = poly[i - 1];
+            f.v[2] = poly[i];
+            facesToRaster[faceCount++] = f;
+        }
+    }
+
+#if defined(RENDER_ZBUFFER) && !defined(RENDER_PIPELINE)
+    depthBuffer->clear();
+#elif !defined(RENDER_ZBUFFER)
+    // Painter's algorithm: far faces first
+    std::sort(facesToRaster, facesToRaster + faceCount, [](const face &f1, const face &f2)
+    {
+        return f1.depth > f2.depth;
+    });
+#endif
+
+    // Rasterize faces
+    for (int i = 0; i < faceCount; i++)
+    {
+        face &f = facesToRaster[i];
+        vec3d<float> &p0 = screenVerts[f.v[0]];
+        vec3d<float> &p1 = screenVerts[f.v[1]];
+        vec3d<float> &p2 = screenVerts[f.v[2]];
+        SubmitTriangle(rasterFixed(p0.x), rasterFixed(p0.y), DepthValue(p0.z),
+                       rasterFixed(p1.x), rasterFixed(p1.y), DepthValue(p1.z),
+                       rasterFixed(p2.x), rasterFixed(p2.y), DepthValue(p2.z), f.color);
+    }
+#else
+    // Wireframe: every shared edge is drawn once, and with the mesh's edge
+    // faces only when one of its two faces points at the camera
+    static bool facing[MAX_MESH_TRIANGLES];
+    bool culling = (meshCube.flags & MESH_EDGE_FACES) != 0;
+    for (int t = 0; culling && t < meshCube.triangleCount; t++)
+    {
+        vec3d<float> &p0 = viewVerts[meshTriangle(meshCube, t, 0)];
+        vec3d<float> &p1 = viewVerts[meshTriangle(meshCube, t, 1)];
+        vec3d<float> &p2 = viewVerts[meshTriangle(meshCube, t, 2)];
+        vec3d<float> normal = FaceNormal(t, p0, p1, p2, matRotZ, matRotX);
+        facing[t] = !BackFacing(normal, p0);
+        cullStats.faces++;
+        if (!facing[t])
+            cullStats.facesCulled++;
+    }
+
+    for (int e = 0; e < meshCube.edgeCount; e++)
+    {
+        if (culling && !facing[meshEdgeFace(meshCube, e, 0)] && !facing[meshEdgeFace(meshCube, e, 1)])
+            continue;
+
+        int a = meshEdge(meshCube, e, 0), b = meshEdge(meshCube, e, 1);
+        vec3d<float> p0 = screenVerts[a];
+        vec3d<float> p1 = screenVerts[b];
+
+        // Edges crossing the near plane end on it
+        vec3d<float> &v0 = viewVerts[a];
+        vec3d<float> &v1 = viewVerts[b];
+        if (v0.z < NEAR_PLANE && v1.z < NEAR_PLANE)
+            continue;
+        if (v0.z < NEAR_PLANE || v1.z < NEAR_PLANE)
+        {
+            vec3d<float> cut = ClipNear(v0, v1);
+            ProjectVertex(cut, (v0.z < NEAR_PLANE) ? p0 : p1, screenWidth, screenHeight);
+        }
+        SubmitLine(p0.x, p0.y, p1.x, p1.y, color);
     }
+#endif
 
+    PROFILE_END(PROFILE_RASTER);
     return true;
 }
 
+#ifdef RENDER_PIPELINE
+void DrawPrimitive(const RenderPrimitive &p, int color)
+{
+    if (p.type == PRIMITIVE_LINE)
+        DrawLine(p.x[0], p.y[0], p.x[1], p.y[1], color);
+    else
+        DrawTriangle(p.x[0], p.y[0], p.z[0], p.x[1], p.y[1], p.z[1], p.x[2], p.y[2], p.z[2], color);
+}
+
+// Geometry side of the pipeline: transforms, culls and queues frame after
+// frame, running ahead of the raster side as far as the queue allows
+void GeometryThread()
+{
+    int width = lcd.getWidth();
+    int height = lcd.getHeight();
+
+    float theta = 0.0f;
+    while (true)
+    {
+        OnUpdate(theta, width, height, Green);
+        renderQueue.pushFrameEnd();
+        theta += 0.05f;
+    }
+}
+
+// Raster side: draw the queued primitives up to the end of the frame
+void DrawQueuedFrame()
+{
+    pipelineFrameCount = 0;
+#ifdef RENDER_ZBUFFER
+    depthBuffer->clear();
+#endif
+
+    RenderPrimitive p;
+    for (renderQueue.pop(p); p.type != PRIMITIVE_FRAME_END; renderQueue.pop(p))
+    {
+        DrawPrimitive(p, p.color);
+        if (pipelineFrameCount < MAX_FRAME_PRIMITIVES)
+            pipelineFrame[pipelineFrameCount++] = p;
+    }
+}
+#endif
+
+// Draw a frame: straight, through the display list (recorded, optimized
+// and replayed) or from the pipeline's geometry thread
+void DrawFrame(float theta, int screenWidth, int screenHeight, int color)
+{
+#if defined(RENDER_PIPELINE)
+    DrawQueuedFrame();
+#elif defined(RENDER_DISPLAYLIST)
+    displayList->clear();
+    OnUpdate(theta, screenWidth, screenHeight, color);
+    displayList->optimize();
+    displayList->replay(&lcd);
+#else
+    OnUpdate(theta, screenWidth, screenHeight, color);
+#endif
+}
+
+// Direct drawing: the frame again in the background colour
+void EraseFrame(float theta, int screenWidth, int screenHeight)
+{
+#if defined(RENDER_PIPELINE)
+#ifdef RENDER_ZBUFFER
+    depthBuffer->clear();
+#endif
+    for (int i = 0; i < pipelineFrameCount; i++)
+        DrawPrimitive(pipelineFrame[i], Black);
+#elif defined(RENDER_DISPLAYLIST)
+    displayList->replay(&lcd, Black);
+#else
+    OnUpdate(theta, screenWidth, screenHeight, Black);
+#endif
+}
+
 int main()
 {
     LCD_LED.write(1);
@@ -217,19 +669,166 @@ int main()
     lcd.setOrientation(1);
     lcd.fillRect(0, 0, lcd.getWidth() - 1, lcd.getHeight() - 1, Black);
 
-    lcd.set_font(font12x12);
+    lcd.set_font(Arial12x12Packed);
     lcd.locate(10, 10);
 
+#ifdef RENDER_BENCH
+    runBenchmarks(&lcd);
+    return 0;
+#endif
+
     int width = lcd.getWidth();
     int height = lcd.getHeight();
 
-    CreateCubeMesh(width, height);
+    CreateProjection(width, height);
+
+    if (meshCube.vertexCount > MAX_MESH_VERTICES || meshCube.triangleCount > MAX_MESH_TRIANGLES)
+    {
+        printf("mesh: %d vertices, %d triangles, at most MAX_MESH_VERTICES %d, MAX_MESH_TRIANGLES %d\n",
+               meshCube.vertexCount, meshCube.triangleCount, MAX_MESH_VERTICES, MAX_MESH_TRIANGLES);
+        return 1;
+    }
+
+#ifdef RENDER_ZBUFFER
+    DepthBuffer depth(width, height);
+    depthBuffer = &depth;
+#endif
+
+#if defined(RENDER_ASYNC)
+    // ping-pong: draw the next frame while the previous one is on the wire
+    FrameBuffer frameA(width, height), frameB(width, height);
+    FrameBuffer* frame = &frameA;
+    FrameBuffer* other = &frameB;
+    lcd.setFrameBuffer(frame);
+#elif defined(RENDER_FRAMEBUFFER)
+    // draw into RAM and send only the damaged area, no erase pass on the panel
+    FrameBuffer frame(width, height);
+    lcd.setFrameBuffer(&frame);
+#elif defined(RENDER_BANDS)
+    // record the frame, then render and send it a band at a time
+    BandRenderer bands(&lcd, Black);
+    bandRenderer = &bands;
+#endif
+
+#ifdef RENDER_DISPLAYLIST
+    DisplayList frameList;
+    displayList = &frameList;
+#endif
+
+#ifdef RENDER_PIPELINE
+    // the next frames are transformed while this thread draws and sends
+    Thread geometry(osPriorityNormal, GEOMETRY_STACK);
+    geometry.start(GeometryThread);
+    uint32_t statsStart = us_ticker_read();
+#endif
+
+    int frames = 0;
+    lcd.resetBusStats();
 
     float theta = 0.0f;
     while(true)
     {
-        OnUpdate(theta, width, height, Green); // draw
-        OnUpdate(theta, width, height, Black); // clear
+        PROFILE_BEGIN_FRAME(lcd.getBusStats().bytes);
+#if defined(RENDER_ASYNC)
+        frame->clear(Black);
+        DrawFrame(theta, width, height, Green); // draw
+        PROFILE_BEGIN(PROFILE_FLUSH);
+        lcd.swapBuffers(other);
+        PROFILE_END(PROFILE_FLUSH);
+
+        FrameBuffer* sent = frame;
+        frame = other;
+        other = sent;
+#elif defined(RENDER_FRAMEBUFFER)
+        frame.clear(Black);
+        DrawFrame(theta, width, height, Green); // draw
+        PROFILE_BEGIN(PROFILE_FLUSH);
+        lcd.flush();
+        PROFILE_END(PROFILE_FLUSH);
+#elif defined(RENDER_BANDS)
+        bands.begin();
+        DrawFrame(theta, width, height, Green); // record
+        PROFILE_BEGIN(PROFILE_FLUSH);
+        bands.end();
+        PROFILE_END(PROFILE_FLUSH);
+#else
+        lcd.beginBatch(); // whole frame under one chip select
+        DrawFrame(theta, width, height, Green); // draw
+#ifdef HOST_PANEL
+        // the erase pass clears the image again, it is taken here
+        lcd.flush();
+        HostPanel::instance().capture();
+#endif
+        EraseFrame(theta, width, height); // clear
+        lcd.endBatch();
+#endif
         theta += 0.05f; // increase angle
+        PROFILE_END_FRAME(lcd.getBusStats().bytes);
+
+#ifdef HOST_PANEL
+#if defined(RENDER_ASYNC)
+        // the emulated panel only has the frame once its transfer is done
+        if (HostPanel::instance().isRecording()) lcd.waitIdle();
+#endif
+        HostPanel::instance().endFrame();
+#endif
+
+        ++frames;
+#ifdef RENDER_OVERLAY
+        if (frames % PROFILE_HISTORY == 0) PROFILE_OVERLAY(&lcd, 0, 0);
+#endif
+
+        if (frames % STATS_FRAMES == 0) {
+            BusStats bus = lcd.getBusStats();
+            printf("spi per frame: %lu bytes, %lu transactions, %lu gpio toggles\n",
+                   (unsigned long)bus.bytes / STATS_FRAMES, (unsigned long)bus.transactions / STATS_FRAMES,
+                   (unsigned long)bus.gpioWrites / STATS_FRAMES);
+            lcd.resetBusStats();
+
+            // direct drawing updates twice per frame, the ratios still hold;
+            // each count is taken and reset in one step, the culled ones
+            // first so they cannot run ahead of their totals
+            unsigned long facesCulled = cullStats.facesCulled.exchange(0);
+            unsigned long faces = cullStats.faces.exchange(0);
+            unsigned long objectsCulled = cullStats.objectsCulled.exchange(0);
+            unsigned long objects = cullStats.objects.exchange(0);
+            printf("culled: %lu of %lu faces, %lu of %lu objects\n", facesCulled, faces, objectsCulled, objects);
+#if defined(RENDER_ASYNC)
+            AsyncStats stats = lcd.getAsyncStats();
+            printf("async: %lu frames, %lu us on the wire, %lu us overlapped\n",
+                   (unsigned long)stats.transfers, (unsigned long)stats.busyUs,
+                   (unsigned long)(stats.busyUs - stats.waitUs));
+#elif defined(RENDER_BANDS)
+            printf("bands: %d rows, peak ram %d bytes\n", BAND_HEIGHT, bands.getPeakRam());
+#endif
+#ifdef RENDER_DISPLAYLIST
+            printf("display list: %d commands, %d bytes\n", frameList.getCount(), frameList.getBytes());
+#endif
+#ifdef RENDER_PIPELINE
+            // a side's busy time is the frame time less its waits
+            QueueStats queue;
+            renderQueue.getStats(queue);
+            renderQueue.resetStats();
+            uint32_t now = us_ticker_read();
+            printf("pipeline: %lu us per frame, geometry waited %lu us, raster waited %lu us\n",
+                   (unsigned long)((now - statsStart) / STATS_FRAMES),
+                   (unsigned long)queue.fullUs / STATS_FRAMES, (unsigned long)queue.emptyUs / STATS_FRAMES);
+            printf("queue: depth avg %lu max %lu of %d\n",
+                   (unsigned long)(queue.pops ? queue.depthSum / queue.pops : 0),
+                   (unsigned long)queue.maxDepth, RENDER_QUEUE_SIZE);
+            statsStart = now;
+#endif
+#ifdef RENDER_PROFILE
+            ProfileSummary summary;
+            FrameProfiler::instance().getSummary(summary);
+            for (int s = 0; s < PROFILE_STAGES; s++) {
+                printf("%-6s min %6lu avg %6lu max %6lu us\n", FrameProfiler::stageName(s),
+                       (unsigned long)summary.minUs[s], (unsigned long)summary.avgUs[s],
+                       (unsigned long)summary.maxUs[s]);
+            }
+            printf("last %d frames: %lu bytes, %lu primitives per frame\n", summary.frames,
+                   (unsigned long)summary.bytes, (unsigned long)summary.primitives);
+#endif
+        }
     }
 }
\ No newline at end of file
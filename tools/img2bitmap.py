@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Convert a PPM or PNG image to a Bitmap565 header for drawBitmap().
+
+    img2bitmap.py image.png [--name logo] [--key RRGGBB] [--raw | --rle] [-o logo.h]
+
+PNG pixels with alpha below 128, and with --key the pixels of that colour,
+become transparent: the bitmap is keyed with a colour no opaque pixel uses.
+The data is stored run-length encoded when that is smaller, unless --raw or
+--rle asks for one of them.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+LITERAL = 0x8000
+MAX_RUN = 0x7FFF
+MAGENTA = 0xF81F
+
+
+def read_ppm(data):
+    """P6 with maxval up to 255 -> width, height, [(r, g, b, a)]."""
+    fields = []
+    pos = 2
+    while len(fields) < 3:
+        m = re.compile(rb"\s*(#[^\n]*\n\s*)*(\d+)").match(data, pos)
+        if not m:
+            raise ValueError("bad PPM header")
+        fields.append(int(m.group(2)))
+        pos = m.end()
+    w, h, maxval = fields
+    if maxval > 255:
+        raise ValueError("16 bit PPM is not supported")
+    pix = data[pos + 1:pos + 1 + w * h * 3]
+    scale = lambda v: v * 255 // maxval
+    return w, h, [(scale(pix[i]), scale(pix[i + 1]), scale(pix[i + 2]), 255)
+                  for i in range(0, w * h * 3, 3)]
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def read_png(data):
+    """8 bit, non-interlaced PNG of any colour type -> width, height, [(r, g, b, a)]."""
+    pos = 8
+    idat = b""
+    palette, trns = [], b""
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            w, h, depth, ctype, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif kind == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b"tRNS":
+            trns = body
+        elif kind == b"IDAT":
+            idat += body
+        elif kind == b"IEND":
+            break
+    if depth != 8 or interlace:
+        raise ValueError("only 8 bit, non-interlaced PNG is supported")
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[ctype]
+    stride = w * channels
+    raw = zlib.decompress(idat)
+    rows, prev = [], bytearray(stride)
+    for y in range(h):
+        kind = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - channels] if i >= channels else 0
+            b = prev[i]
+            c = prev[i - channels] if i >= channels else 0
+            if kind == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif kind == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif kind == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif kind == 4:
+                line[i] = (line[i] + paeth(a, b, c)) & 0xFF
+        rows.append(line)
+        prev = line
+
+    pixels = []
+    for line in rows:
+        for x in range(w):
+            p = line[x * channels:(x + 1) * channels]
+            if ctype == 0:
+                pixels.append((p[0], p[0], p[0], 255))
+            elif ctype == 2:
+                pixels.append((p[0], p[1], p[2], 255))
+            elif ctype == 3:
+                alpha = trns[p[0]] if p[0] < len(trns) else 255
+                pixels.append(palette[p[0]] + (alpha,))
+            elif ctype == 4:
+                pixels.append((p[0], p[0], p[0], p[1]))
+            else:
+                pixels.append(tuple(p))
+    return w, h, pixels
+
+
+def rgb565(r, g, b):
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def encode_rle(w, h, words, key):
+    """Runs per row; with a key, transparent pixels are only repeat runs."""
+    out = []
+    for y in range(h):
+        row = words[y * w:(y + 1) * w]
+        x = 0
+        literal = []
+        while x < w:
+            n = 1
+            while x + n < w and n < MAX_RUN and row[x + n] == row[x]:
+                n += 1
+            if n >= 3 or row[x] == key:
+                if literal:
+                    out += [LITERAL | len(literal)] + literal
+                    literal = []
+                out += [n, row[x]]
+            else:
+                literal += row[x:x + n]
+                if len(literal) >= MAX_RUN:
+                    out += [LITERAL | len(literal[:MAX_RUN])] + literal[:MAX_RUN]
+                    literal = literal[MAX_RUN:]
+            x += n
+        if literal:
+            out += [LITERAL | len(literal)] + literal
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="PPM/PNG to Bitmap565 header")
+    parser.add_argument("image")
+    parser.add_argument("--name", help="C name, default from the file name")
+    parser.add_argument("--key", help="RRGGBB colour to make transparent")
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument("--raw", action="store_true", help="store pixels as they are")
+    group.add_argument("--rle", action="store_true", help="store runs")
+    parser.add_argument("-o", "--output", help="header to write, default stdout")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        data = f.read()
+    if data.startswith(b"P6"):
+        w, h, pixels = read_ppm(data)
+    elif data.startswith(b"\x89PNG"):
+        w, h, pixels = read_png(data)
+    else:
+        sys.exit("%s: not a P6 PPM or PNG file" % args.image)
+
+    name = args.name or re.sub(r"\W", "_", os.path.splitext(os.path.basename(args.image))[0])
+    transparent = [p[3] < 128 for p in pixels]
+    if args.key:
+        k = int(args.key, 16)
+        colour = ((k >> 16) & 0xFF, (k >> 8) & 0xFF, k & 0xFF)
+        transparent = [t or p[:3] == colour for t, p in zip(transparent, pixels)]
+
+    words = [rgb565(*p[:3]) for p in pixels]
+    keyed = any(transparent)
+    key = 0
+    if keyed:
+        used = set(c for c, t in zip(words, transparent) if not t)
+        key = MAGENTA
+        while key in used:
+            key = (key + 1) & 0xFFFF
+        words = [key if t else c for c, t in zip(words, transparent)]
+
+    rle = encode_rle(w, h, words, key if keyed else None)
+    use_rle = args.rle or (not args.raw and len(rle) < len(words))
+    body = rle if use_rle else words
+
+    lines = ["// %s, %dx%d, generated by tools/img2bitmap.py from %s"
+             % (name, w, h, os.path.basename(args.image)),
+             "",
+             "#ifndef %s_H" % name.upper(),
+             "#define %s_H" % name.upper(),
+             "",
+             '#include "Bitmap565.h"',
+             "",
+             "static const uint16_t %s_data[] = {" % name]
+    for i in range(0, len(body), 12):
+        lines.append("    " + ", ".join("0x%04X" % v for v in body[i:i + 12]) + ",")
+    lines += ["};",
+              "",
+              "const Bitmap565 %s = { %d, %d, %s, %d, 0x%04X, %s_data };"
+              % (name, w, h, "BITMAP_RLE" if use_rle else "BITMAP_RAW", int(keyed), key, name),
+              "",
+              "#endif",
+              ""]
+
+    text = "\n".join(lines)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
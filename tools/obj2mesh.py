@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Convert a Wavefront OBJ model to a PackedMesh header.
+
+    obj2mesh.py model.obj [--name model] [--normals] [-o model.h]
+
+Only the geometry is read: vertex positions ("v") and faces ("f"), whose
+polygons are split into triangle fans. Texture coordinates, normals,
+groups and materials are ignored, vertices no face uses are dropped.
+Positions are quantized to 16 bits over the model's bounding box; --normals
+adds a packed normal per triangle for flat shading without a cross product.
+Every edge keeps the two triangles it borders, so wireframes can leave out
+the edges of faces turned away.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+
+QUANT = 32767           # positions run from -QUANT to QUANT over the box
+NORMAL_ONE = 127
+
+
+def read_obj(text):
+    """OBJ text -> [(x, y, z)], [(a, b, c)] with 0-based indices."""
+    verts, tris = [], []
+    for number, line in enumerate(text.splitlines(), 1):
+        fields = line.split("#", 1)[0].split()
+        if not fields:
+            continue
+        if fields[0] == "v":
+            verts.append(tuple(float(f) for f in fields[1:4]))
+        elif fields[0] == "f":
+            face = []
+            for f in fields[1:]:
+                i = int(f.split("/")[0])
+                i = i - 1 if i > 0 else len(verts) + i
+                if not 0 <= i < len(verts):
+                    raise ValueError("line %d: vertex %s does not exist" % (number, f))
+                face.append(i)
+            for k in range(2, len(face)):
+                tris.append((face[0], face[k - 1], face[k]))
+    return verts, tris
+
+
+def f32(v):
+    """v rounded to the float the target will hold."""
+    return struct.unpack("f", struct.pack("f", v))[0]
+
+
+def quantize(verts):
+    """-> offsets, scales, [(qx, qy, qz)] with position = offset + q * scale."""
+    offset, scale = [], []
+    for axis in range(3):
+        lo = min(v[axis] for v in verts)
+        hi = max(v[axis] for v in verts)
+        offset.append(f32((lo + hi) / 2))
+        scale.append(f32((hi - lo) / (2 * QUANT)) if hi > lo else 1.0)
+    quant = [tuple(max(-QUANT, min(QUANT, int(round((v[a] - offset[a]) / scale[a])))) for a in range(3))
+             for v in verts]
+    return offset, scale, quant
+
+
+def sub(a, b):
+    return (a[0] - b[0], a[1] - b[1], a[2] - b[2])
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def c_array(ctype, name, values, per_line=12, fmt="%d"):
+    lines = ["static const %s %s[] = {" % (ctype, name)]
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(fmt % v for v in values[i:i + per_line]) + ",")
+    lines.append("};")
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OBJ to PackedMesh header")
+    parser.add_argument("model")
+    parser.add_argument("--name", help="C name, default from the file name")
+    parser.add_argument("--normals", action="store_true", help="store a normal per triangle")
+    parser.add_argument("-o", "--output", help="header to write, default stdout")
+    args = parser.parse_args()
+
+    with open(args.model) as f:
+        verts, tris = read_obj(f.read())
+    if not tris:
+        sys.exit("%s: no faces" % args.model)
+
+    # vertices in order of first use, unused ones dropped
+    remap = {}
+    for t in tris:
+        for i in t:
+            remap.setdefault(i, len(remap))
+    if len(remap) > 65535:
+        sys.exit("%s: %d vertices, at most 65535 fit" % (args.model, len(remap)))
+    order = sorted(remap, key=remap.get)
+    verts = [verts[i] for i in order]
+    tris = [tuple(remap[i] for i in t) for t in tris]
+    if len(tris) > 65535:
+        sys.exit("%s: %d triangles, at most 65535 fit" % (args.model, len(tris)))
+
+    offset, scale, quant = quantize(verts)
+    decoded = [tuple(offset[a] + q[a] * scale[a] for a in range(3)) for q in quant]
+
+    # unique edges and the triangles on them, an edge of one triangle
+    # names it twice, one of more keeps the first two
+    edge_tris = {}
+    for n, t in enumerate(tris):
+        for k in range(3):
+            edge_tris.setdefault((min(t[k], t[(k + 1) % 3]), max(t[k], t[(k + 1) % 3])), []).append(n)
+    edges = sorted(edge_tris)
+    if len(edges) > 65535:
+        sys.exit("%s: %d edges, at most 65535 fit" % (args.model, len(edges)))
+    edge_faces = [i for e in edges for i in (edge_tris[e] * 2)[:2]]
+
+    # bounding sphere around the centre of the box, slightly grown so the
+    # target's float rounding cannot leave a vertex outside
+    center = [f32((min(v[a] for v in decoded) + max(v[a] for v in decoded)) / 2) for a in range(3)]
+    radius = max(math.sqrt(sum((v[a] - center[a]) ** 2 for a in range(3))) for v in decoded)
+    radius = f32(radius * 1.0001 + 1e-6)
+
+    normals = []
+    if args.normals:
+        for t in tris:
+            n = cross(sub(decoded[t[1]], decoded[t[0]]), sub(decoded[t[2]], decoded[t[0]]))
+            l = math.sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) or 1.0
+            normals += [int(round(c / l * NORMAL_ONE)) for c in n]
+
+    name = args.name or re.sub(r"\W", "_", os.path.splitext(os.path.basename(args.model))[0])
+    wide = len(verts) > 256
+    index_type = "uint16_t" if wide else "uint8_t"
+    flags = (["MESH_INDEX16"] if wide else []) + (["MESH_NORMALS"] if args.normals else []) + ["MESH_EDGE_FACES"]
+    index_bytes = 2 if wide else 1
+    size = len(verts) * 6 + (len(tris) * 3 + len(edges) * 2) * index_bytes + len(normals) + len(edge_faces) * 2
+
+    lines = ["// %s, %d vertices, %d triangles, %d edges, %d bytes, generated by tools/obj2mesh.py from %s"
+             % (name, len(verts), len(tris), len(edges), size, os.path.basename(args.model)),
+             "",
+             "#ifndef %s_H" % name.upper(),
+             "#define %s_H" % name.upper(),
+             "",
+             '#include "PackedMesh.h"',
+             ""]
+    lines += c_array("int16_t", name + "_positions", [c for q in quant for c in q], 12)
+    lines.append("")
+    lines += c_array(index_type, name + "_triangles", [i for t in tris for i in t], 12)
+    lines.append("")
+    lines += c_array(index_type, name + "_edges", [i for e in edges for i in e], 12)
+    lines.append("")
+    if args.normals:
+        lines += c_array("int8_t", name + "_normals", normals, 12)
+        lines.append("")
+    lines += c_array("uint16_t", name + "_edge_faces", edge_faces, 12)
+    lines.append("")
+    g = lambda v: repr(float(v)) + "f"
+    lines += ["const PackedMesh %s = {" % name,
+              "    %d, %d, %d, %s, 0," % (len(verts), len(tris), len(edges), " | ".join(flags) or "0"),
+              "    { %s }," % ", ".join(g(s) for s in scale),
+              "    { %s }," % ", ".join(g(o) for o in offset),
+              "    { %s }, %s," % (", ".join(g(c) for c in center), g(radius)),
+              "    %s_positions, %s_triangles, %s_edges, %s, %s_edge_faces"
+              % (name, name, name, name + "_normals" if args.normals else "NULL", name),
+              "};",
+              "",
+              "#endif",
+              ""]
+
+    text = "\n".join(lines)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()